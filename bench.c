@@ -0,0 +1,759 @@
+#include "headers/circle.h"
+#include "headers/link.h"
+#include "headers/world.h"
+#include "headers/profile.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// headless benchmark, runs scripted scenarios from a fixed seed and prints the timings as csv or json so builds can be compared.
+// every scenario is deterministic for a given seed and worker count, the checksum column says whether two builds simulated the same thing
+
+const Vector2 CENTER = { 450, 450 };
+const float FRAME_DT = 1.0f / 60.0f;
+
+typedef enum
+{
+	CSV = 0,
+	JSON = 1,
+} OutputFormat;
+
+typedef struct
+{
+	const char* scenario;   // NULL runs every scenario
+	int steps;              // 0 takes each scenario's own
+	int substeps;           // 0 takes each scenario's own
+	int workers;
+	int cloth_size;
+	int max_particles;      // largest count the scale scenario goes up to
+	unsigned int seed;
+	Broadphase broadphase;
+	bool sleeping;
+	int reorder_interval;
+	OutputFormat format;
+	const char* trace_path; // records every run into one chrome trace, which slows the runs a little
+	ProfileTrace* trace;
+	bool counting;          // hardware counters per phase, adds their columns
+	const char* histogram_path; // the step time histogram of every run as csv
+	FILE* histogram_file;
+} BenchSettings;
+
+// one measured run, a scenario may produce several cases
+typedef struct
+{
+	const char* scenario;
+	char name[32];
+	int particles;
+	int links;
+	int steps;
+	int substeps;
+	bool sleeping;          // a scenario may sleep circles without --sleep
+	double seconds;
+	double phase_ms[PHASE_COUNT];
+	long long circle_substeps;
+	unsigned int neighbor_builds;
+	double checksum;
+	long long counters[PHASE_COUNT][COUNTER_COUNT];
+	int counted;            // mask of the counter kinds that were read
+	Histogram step_times;
+} BenchResult;
+
+// xorshift, so a seed gives the same scene on every platform
+static unsigned int next_random(unsigned int* state)
+{
+	unsigned int x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return *state = x;
+}
+
+static float random_range(unsigned int* state, float low, float high)
+{
+	return low + (high - low) * ((next_random(state) & 0xFFFFFF) / (float)0xFFFFFF);
+}
+
+static double now_seconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+static VerletWorld create_bench_world(const BenchSettings* settings)
+{
+	VerletWorld world = create_world();
+
+	world.broadphase = settings->broadphase;
+	world.sleeping = settings->sleeping;
+	world.worker_count = settings->workers;
+	world.reorder_interval = settings->reorder_interval;
+	world.counting = settings->counting;
+
+	return world;
+}
+
+static VerletCirlce make_circle(Vector2 position, float radius, Status status)
+{
+	VerletCirlce circle;
+
+	circle.color = (Color){ 255, 255, 255, 255 };
+	circle.radius = radius;
+	circle.status = status;
+	circle.acceleration = (Vector2){ 0 };
+	circle.current_position = circle.previous_position = position;
+
+	return circle;
+}
+
+static double position_checksum(const Circles* circles)
+{
+	double sum = 0;
+
+	for(int i = 0; i < circles->size; i++)
+		sum += circles->x[i] + circles->y[i];
+
+	return sum;
+}
+
+// runs a prepared world for its steps and substeps, calling script before each one, and fills in the result
+static void measure(VerletWorld* world, BenchResult* result, const BenchSettings* settings, void (*script)(VerletWorld* world, int step, void* context), void* context)
+{
+	reset_world_stats(world);
+	clear_histogram(&result->step_times);
+
+	double start = now_seconds();
+
+	for(int s = 0; s < result->steps; s++)
+	{
+		if(script != NULL)
+			script(world, s, context);
+
+		long long step_start = profile_now();
+		world_step(world, FRAME_DT, result->substeps);
+		record_histogram(&result->step_times, (profile_now() - step_start));
+
+		if(settings->trace != NULL)
+			poll_profile_trace(settings->trace);
+	}
+
+	result->seconds = now_seconds() - start;
+	result->sleeping = world->sleeping;
+	result->particles = world->circles.size;
+	result->links = world->chain.alive_count;
+	result->circle_substeps = world->stats.circle_substeps;
+	result->neighbor_builds = (world->neighbors != NULL) ? world->neighbors->builds : 0;
+	result->checksum = position_checksum(&world->circles);
+
+	for(int p = 0; p < PHASE_COUNT; p++)
+	{
+		result->phase_ms[p] = atomic_load(&world->stats.phase_ns[p]) / 1e6;
+
+		for(int k = 0; k < COUNTER_COUNT; k++)
+			result->counters[p][k] = atomic_load(&world->stats.counters[p][k]);
+	}
+
+	result->counted = atomic_load(&world->stats.counted);
+}
+
+typedef struct
+{
+	unsigned int random;
+	float radius;
+	int capacity;
+	int per_step;
+} Filler;
+
+// the playground's own limit for a border of radius R filled with circles of radius r
+static int max_circle_count(float R, float r)
+{
+	return (int)(0.83 * ((R * R) / (r * r)) - 1.9);
+}
+
+static void spawn_balls(VerletWorld* world, int step, void* context)
+{
+	Filler* filler = context;
+
+	for(int b = 0; (b < filler->per_step) && (world->circles.size < filler->capacity); b++)
+	{
+		Vector2 position = { CENTER.x + random_range(&filler->random, -150, 150), CENTER.y - random_range(&filler->random, 150, 250) };
+		add_verlet_circle(&world->circles, make_circle(position, filler->radius, FREE));
+	}
+}
+
+// fills the playground border to its limit over the first half of the run, then lets the pile settle
+static bool bench_fill(const BenchSettings* settings, BenchResult* result)
+{
+	const float BORDER_RADIUS = 300, BALL_RADIUS = 5;
+	VerletWorld world = create_bench_world(settings);
+	Filler filler = { settings->seed, BALL_RADIUS, max_circle_count(BORDER_RADIUS, BALL_RADIUS), 0 };
+
+	world.collide = true;
+	world.bounded = true;
+	world.border_center = CENTER;
+	world.border_radius = BORDER_RADIUS;
+
+	result->steps = (settings->steps > 0) ? settings->steps : 600;
+	result->substeps = (settings->substeps > 0) ? settings->substeps : 8;
+	filler.per_step = 1 + (2 * filler.capacity) / result->steps;
+	snprintf(result->name, sizeof(result->name), "%d", filler.capacity);
+
+	measure(&world, result, settings, spawn_balls, &filler);
+	dealloc_world(&world);
+
+	return true;
+}
+
+// the cloth demo's sheet, rows start bunched together under a pinned top row and drop to their length. the demo solves the
+// links 10 times in a single substep, which the cloth scenarios run too unless told otherwise
+static void build_cloth(VerletWorld* world, BenchResult* result, const BenchSettings* settings)
+{
+	int size = settings->cloth_size;
+	const float WIDTH = 700, HEIGHT = 840, RADIUS = 5;
+	float spacing = WIDTH / (size - 1), row_length = HEIGHT / (size - 1);
+
+	for(int r = 0; r < size; r++)
+		for(int c = 0; c < size; c++)
+			add_verlet_circle(&world->circles, make_circle((Vector2){ 100 + (c * spacing), 30 + r }, RADIUS, (r == 0) ? SUSPENDED : FREE));
+
+	for(int r = 0; r < size; r++)
+		for(int c = 0; c < size; c++)
+		{
+			int i = (r * size) + c;
+
+			if(c + 1 < size)
+				add_link(&world->chain, &world->circles, (Link){ circle_handle(&world->circles, i), circle_handle(&world->circles, i + 1), spacing });
+
+			if(r + 1 < size)
+				add_link(&world->chain, &world->circles, (Link){ circle_handle(&world->circles, i), circle_handle(&world->circles, i + size), row_length });
+		}
+
+	world->gravity = (Vector2){ 0, 2000.0f };
+	world->damping = 0.975f;
+	world->link_iterations = 10;
+
+	result->steps = (settings->steps > 0) ? settings->steps : 300;
+	result->substeps = (settings->substeps > 0) ? settings->substeps : 1;
+	snprintf(result->name, sizeof(result->name), "%dx%d", size, size);
+}
+
+static bool bench_cloth(const BenchSettings* settings, BenchResult* result)
+{
+	VerletWorld world = create_bench_world(settings);
+
+	build_cloth(&world, result, settings);
+	measure(&world, result, settings, NULL, NULL);
+	dealloc_world(&world);
+
+	return true;
+}
+
+// the cut path runs from (50, CUT_TOP) to (850, CUT_TOP + 200) over CUT_STEPS steps
+const float CUT_TOP = 300;
+const int CUT_STEPS = 60;
+
+typedef struct
+{
+	CircleHandle lowest;    // middle of the bottom row
+	int start;              // step the sweep began on, -1 until the cloth has dropped through the path
+} Cut;
+
+// once the bottom row has dropped past the cut path, the cursor cuts across the cloth on a slight diagonal, left to right
+static void cut_cloth(VerletWorld* world, int step, void* context)
+{
+	Cut* cut = context;
+
+	if((cut->start < 0) && (world->circles.y[circle_index(&world->circles, cut->lowest)] >= CUT_TOP + 200))
+		cut->start = step;
+
+	float t = (step - cut->start) / (float)CUT_STEPS;
+
+	world->input.cut = (cut->start >= 0) && (t <= 1);
+	world->input.cursor = (Vector2){ 50 + (800 * t), CUT_TOP + (200 * t) };
+}
+
+// fails when the run ended before the cut got through a link, a tear that tore nothing is only the cloth scenario again
+static bool bench_tear(const BenchSettings* settings, BenchResult* result)
+{
+	VerletWorld world = create_bench_world(settings);
+	int size = settings->cloth_size;
+
+	build_cloth(&world, result, settings);
+
+	Cut cut = { circle_handle(&world.circles, ((size - 1) * size) + (size / 2)), -1 };
+	int links = world.chain.alive_count;
+
+	measure(&world, result, settings, cut_cloth, &cut);
+	dealloc_world(&world);
+
+	if(result->links < links)
+		return true;
+
+	fprintf(stderr, "tear cut no links in %d steps, the cloth had not dropped through the cut yet\n", result->steps);
+	return false;
+}
+
+// the pile settles asleep before the run, then a column is erased from under it. circles over the hole are tracked
+// through their handles, reordering and erasing move them to other indicies
+#define DIG_TRACKED 256
+
+// fails when the circles over the hole stayed where they were, a pile that hangs in the air over nothing
+static bool bench_dig(const BenchSettings* settings, BenchResult* result)
+{
+	const float BORDER_RADIUS = 300, RADIUS = 4, HOLE_RADIUS = 15, HOLE_TOP = CENTER.y + 190;
+	const int COUNT = 2000, COLUMNS = 60, SETTLE_STEPS = 900;
+	VerletWorld world = create_bench_world(settings);
+	unsigned int random = settings->seed;
+	CircleHandle tracked[DIG_TRACKED];
+	float tracked_y[DIG_TRACKED];
+	int tracked_count = 0, fallen = 0;
+
+	world.collide = true;
+	world.bounded = true;
+	world.sleeping = true;
+	world.border_center = CENTER;
+	world.border_radius = BORDER_RADIUS;
+
+	for(int i = 0; i < COUNT; i++)
+	{
+		Vector2 position = { CENTER.x - 250 + (8.5f * (i % COLUMNS)), CENTER.y + (4.5f * (i / COLUMNS)) };
+		position.x += random_range(&random, -0.25f, 0.25f);
+
+		add_verlet_circle(&world.circles, make_circle(position, RADIUS, FREE));
+	}
+
+	result->steps = (settings->steps > 0) ? settings->steps : 300;
+	result->substeps = (settings->substeps > 0) ? settings->substeps : 8;
+	snprintf(result->name, sizeof(result->name), "%d", COUNT);
+
+	for(int s = 0; s < SETTLE_STEPS; s++)
+		world_step(&world, FRAME_DT, result->substeps);
+
+	for(int i = 0; (i < world.circles.size) && (tracked_count < DIG_TRACKED); i++)
+		if((fabsf(world.circles.x[i] - CENTER.x) < HOLE_RADIUS - RADIUS) && (world.circles.y[i] < HOLE_TOP))
+		{
+			tracked[tracked_count] = circle_handle(&world.circles, i);
+			tracked_y[tracked_count++] = world.circles.y[i];
+		}
+
+	for(float y = CENTER.y + BORDER_RADIUS - 10; y > HOLE_TOP; y -= 10)
+		world_erase(&world, (Vector2){ CENTER.x, y }, HOLE_RADIUS);
+
+	measure(&world, result, settings, NULL, NULL);
+
+	for(int t = 0; t < tracked_count; t++)
+	{
+		int i = circle_index(&world.circles, tracked[t]);
+		fallen += (i != -1) && (world.circles.y[i] - tracked_y[t] > 2 * RADIUS);
+	}
+
+	dealloc_world(&world);
+
+	if((tracked_count > 0) && (fallen * 2 > tracked_count))
+		return true;
+
+	fprintf(stderr, "dig left %d of %d circles over the hole in the air after %d steps\n", (tracked_count - fallen), tracked_count, result->steps);
+	return false;
+}
+
+// a jittered lattice of small circles filling the middle of a border twice its area, falling into a pile
+static void bench_scale_case(const BenchSettings* settings, BenchResult* result, int count)
+{
+	const float RADIUS = 2, SPACING = 2.5f * RADIUS;
+	VerletWorld world = create_bench_world(settings);
+	unsigned int random = settings->seed;
+	int side = (int)ceilf(sqrtf(count));
+
+	world.collide = true;
+	world.bounded = true;
+	world.border_center = CENTER;
+	world.border_radius = SPACING * side;
+
+	for(int i = 0; i < count; i++)
+	{
+		Vector2 position = { CENTER.x + SPACING * ((i % side) - (side / 2.0f)), CENTER.y + SPACING * ((i / side) - (side / 2.0f)) };
+		position.x += random_range(&random, -0.25f, 0.25f);
+		position.y += random_range(&random, -0.25f, 0.25f);
+
+		add_verlet_circle(&world.circles, make_circle(position, RADIUS, FREE));
+	}
+
+	snprintf(result->name, sizeof(result->name), "%d", count);
+	measure(&world, result, settings, NULL, NULL);
+	dealloc_world(&world);
+}
+
+typedef struct
+{
+	const char* name;
+	bool (*run)(const BenchSettings* settings, BenchResult* result);    // false when the run did not do what the scenario is for
+} Scenario;
+
+const Scenario SCENARIOS[] =
+{
+	{ "fill", bench_fill },
+	{ "cloth", bench_cloth },
+	{ "tear", bench_tear },
+	{ "dig", bench_dig },
+	{ "scale", NULL },      // one case per power of ten, run by run_scenario
+};
+
+const int SCENARIO_COUNT = sizeof(SCENARIOS) / sizeof(Scenario);
+
+static const char* broadphase_name(Broadphase broadphase)
+{
+	switch(broadphase)
+	{
+		case DENSE_GRID: return "grid";
+		case HASHED_GRID: return "hash";
+		case NEIGHBOR_LIST: return "list";
+		default: return "unknown";
+	}
+}
+
+static double steps_per_second(const BenchResult* result)
+{
+	return (result->seconds > 0) ? (result->steps / result->seconds) : 0;
+}
+
+static double ns_per_circle_substep(const BenchResult* result)
+{
+	return (result->circle_substeps > 0) ? ((result->seconds * 1e9) / result->circle_substeps) : 0;
+}
+
+// what the counters come to for a phase, or every phase for PHASE_COUNT: instructions per cycle, then each kind of
+// miss per particle per substep. false for a figure whose counters could not be read
+#define DERIVED_COUNT 4
+
+const char* DERIVED_NAMES[DERIVED_COUNT] = { "ipc", "l1d_misses_pp", "llc_misses_pp", "branch_misses_pp" };
+
+static void derive_counters(const BenchResult* result, int phase, double derived[DERIVED_COUNT], bool valid[DERIVED_COUNT])
+{
+	const CounterKind MISSES[DERIVED_COUNT - 1] = { COUNTER_L1D_MISSES, COUNTER_LLC_MISSES, COUNTER_BRANCH_MISSES };
+	double totals[COUNTER_COUNT] = { 0 };
+
+	for(int p = 0; p < PHASE_COUNT; p++)
+		if((phase == PHASE_COUNT) || (phase == p))
+			for(int k = 0; k < COUNTER_COUNT; k++)
+				totals[k] += result->counters[p][k];
+
+	valid[0] = (result->counted & (1 << COUNTER_CYCLES)) && (result->counted & (1 << COUNTER_INSTRUCTIONS)) && (totals[COUNTER_CYCLES] > 0);
+	derived[0] = valid[0] ? (totals[COUNTER_INSTRUCTIONS] / totals[COUNTER_CYCLES]) : 0;
+
+	for(int m = 0; m < DERIVED_COUNT - 1; m++)
+	{
+		valid[m + 1] = (result->counted & (1 << MISSES[m])) && (result->circle_substeps > 0);
+		derived[m + 1] = valid[m + 1] ? (totals[MISSES[m]] / result->circle_substeps) : 0;
+	}
+}
+
+// counters are reported for every phase together first, then for each phase
+static int counter_scope(int s)
+{
+	return (s == 0) ? PHASE_COUNT : (s - 1);
+}
+
+static const char* counter_scope_name(int phase)
+{
+	return (phase == PHASE_COUNT) ? "total" : step_phase_name(phase);
+}
+
+// the tail of step times, max being the 100th percentile
+#define QUANTILE_COUNT 4
+
+const double QUANTILES[QUANTILE_COUNT] = { 50, 95, 99, 100 };
+const char* QUANTILE_NAMES[QUANTILE_COUNT] = { "p50", "p95", "p99", "max" };
+
+static void print_csv_header(const BenchSettings* settings)
+{
+	printf("scenario,case,particles,links,workers,broadphase,sleeping,substeps,steps,seconds,steps_per_second,ns_per_particle_substep,step_p50_ms,step_p95_ms,step_p99_ms,step_max_ms");
+
+	for(int p = 0; p < PHASE_COUNT; p++)
+		printf(",%s_ms", step_phase_name(p));
+
+	printf(",neighbor_builds,checksum");
+
+	if(settings->counting)
+		for(int s = 0; s <= PHASE_COUNT; s++)
+			for(int d = 0; d < DERIVED_COUNT; d++)
+				printf(",%s_%s", counter_scope_name(counter_scope(s)), DERIVED_NAMES[d]);
+
+	printf("\n");
+}
+
+static void print_csv(const BenchResult* result, const BenchSettings* settings)
+{
+	printf("%s,%s,%d,%d,%d,%s,%d,%d,%d,%.6f,%.3f,%.3f", result->scenario, result->name, result->particles, result->links, settings->workers, broadphase_name(settings->broadphase),
+		result->sleeping, result->substeps, result->steps, result->seconds, steps_per_second(result), ns_per_circle_substep(result));
+
+	for(int q = 0; q < QUANTILE_COUNT; q++)
+		printf(",%.4f", histogram_percentile(&result->step_times, QUANTILES[q]) / 1e6);
+
+	for(int p = 0; p < PHASE_COUNT; p++)
+		printf(",%.3f", result->phase_ms[p]);
+
+	printf(",%u,%.3f", result->neighbor_builds, result->checksum);
+
+	// counters that could not be read leave their fields empty
+	if(settings->counting)
+		for(int s = 0; s <= PHASE_COUNT; s++)
+		{
+			double derived[DERIVED_COUNT];
+			bool valid[DERIVED_COUNT];
+
+			derive_counters(result, counter_scope(s), derived, valid);
+
+			for(int d = 0; d < DERIVED_COUNT; d++)
+				valid[d] ? printf(",%.4f", derived[d]) : printf(",");
+		}
+
+	printf("\n");
+}
+
+// runs nest as settings, then scenario, then case, then phase
+static void print_json_header(const BenchSettings* settings)
+{
+	printf("{\n\t\"settings\": { \"workers\": %d, \"broadphase\": \"%s\", \"sleeping\": %s, \"seed\": %u, \"reorder_interval\": %d, \"simd\": \"%s\" },\n\t\"runs\": [",
+		settings->workers, broadphase_name(settings->broadphase), settings->sleeping ? "true" : "false", settings->seed, settings->reorder_interval,
+	#if defined(__AVX2__)
+		"avx2"
+	#elif defined(__SSE2__)
+		"sse2"
+	#else
+		"scalar"
+	#endif
+	);
+}
+
+static void print_json(const BenchResult* result, const BenchSettings* settings, bool first)
+{
+	printf("%s\n\t\t{ \"scenario\": \"%s\", \"case\": \"%s\", \"particles\": %d, \"links\": %d, \"substeps\": %d, \"sleeping\": %s, \"steps\": %d, \"seconds\": %.6f, \"steps_per_second\": %.3f, \"ns_per_particle_substep\": %.3f,\n\t\t  \"phases_ms\": { ",
+		first ? "" : ",", result->scenario, result->name, result->particles, result->links, result->substeps, result->sleeping ? "true" : "false", result->steps, result->seconds, steps_per_second(result), ns_per_circle_substep(result));
+
+	for(int p = 0; p < PHASE_COUNT; p++)
+		printf("%s\"%s\": %.3f", (p > 0) ? ", " : "", step_phase_name(p), result->phase_ms[p]);
+
+	printf(" },\n\t\t  \"step_ms\": { ");
+
+	for(int q = 0; q < QUANTILE_COUNT; q++)
+		printf("%s\"%s\": %.4f", (q > 0) ? ", " : "", QUANTILE_NAMES[q], histogram_percentile(&result->step_times, QUANTILES[q]) / 1e6);
+
+	printf(" }, \"neighbor_builds\": %u, \"checksum\": %.3f", result->neighbor_builds, result->checksum);
+
+	// raw counts and what they come to per scope, null where a counter could not be read
+	if(settings->counting)
+	{
+		printf(",\n\t\t  \"counters\": {");
+
+		for(int s = 0; s <= PHASE_COUNT; s++)
+		{
+			int scope = counter_scope(s);
+			double derived[DERIVED_COUNT];
+			bool valid[DERIVED_COUNT];
+
+			derive_counters(result, scope, derived, valid);
+			printf("%s\n\t\t\t\"%s\": { ", (s > 0) ? "," : "", counter_scope_name(scope));
+
+			for(int k = 0; k < COUNTER_COUNT; k++)
+			{
+				long long total = 0;
+
+				for(int p = 0; p < PHASE_COUNT; p++)
+					if((scope == PHASE_COUNT) || (scope == p))
+						total += result->counters[p][k];
+
+				(result->counted & (1 << k)) ? printf("\"%s\": %lld, ", counter_name(k), total) : printf("\"%s\": null, ", counter_name(k));
+			}
+
+			for(int d = 0; d < DERIVED_COUNT; d++)
+				valid[d] ? printf("%s\"%s\": %.4f", (d > 0) ? ", " : "", DERIVED_NAMES[d], derived[d]) : printf("%s\"%s\": null", (d > 0) ? ", " : "", DERIVED_NAMES[d]);
+
+			printf(" }");
+		}
+
+		printf(" }");
+	}
+
+	printf(" }");
+}
+
+static void report(const BenchResult* result, const BenchSettings* settings, int* reported)
+{
+	if(settings->format == JSON)
+		print_json(result, settings, (*reported == 0));
+	else
+		print_csv(result, settings);
+
+	if(settings->histogram_file != NULL)
+	{
+		char series[96];
+
+		snprintf(series, sizeof(series), "%s/%s", result->scenario, result->name);
+		write_histogram_csv(settings->histogram_file, series, &result->step_times);
+	}
+
+	fflush(stdout);
+	(*reported)++;
+}
+
+static bool run_scenario(const Scenario* scenario, const BenchSettings* settings, int* reported)
+{
+	BenchResult result = { 0 };
+	result.scenario = scenario->name;
+
+	if(scenario->run != NULL)
+	{
+		if(!scenario->run(settings, &result))
+			return false;
+
+		report(&result, settings, reported);
+		return true;
+	}
+
+	// bigger counts get fewer steps unless told otherwise, a million circles for hundreds of steps is minutes on one core
+	for(int count = 1000; count <= settings->max_particles; count *= 10)
+	{
+		result = (BenchResult){ .scenario = scenario->name };
+		result.steps = (settings->steps > 0) ? settings->steps : ((count >= 100000) ? 30 : 120);
+		result.substeps = (settings->substeps > 0) ? settings->substeps : 8;
+		bench_scale_case(settings, &result, count);
+		report(&result, settings, reported);
+	}
+
+	return true;
+}
+
+static void usage(const char* program)
+{
+	fprintf(stderr, "usage: %s [--scenario fill|cloth|tear|dig|scale] [--steps n] [--substeps n] [--workers n] [--cloth n] [--max-particles n]\n"
+		"\t[--seed n] [--broadphase grid|hash|list] [--sleep] [--reorder n] [--json] [--trace file.json] [--counters] [--histogram file.csv]\n", program);
+}
+
+static bool parse_settings(int argc, char** argv, BenchSettings* settings)
+{
+	for(int a = 1; a < argc; a++)
+	{
+		const char* flag = argv[a];
+		const char* value = (a + 1 < argc) ? argv[a + 1] : NULL;
+		bool takes_value = true;
+
+		if(strcmp(flag, "--sleep") == 0)
+			settings->sleeping = true, takes_value = false;
+		else if(strcmp(flag, "--counters") == 0)
+			settings->counting = true, takes_value = false;
+		else if(strcmp(flag, "--json") == 0)
+			settings->format = JSON, takes_value = false;
+		else if(value == NULL)
+			return false;
+		else if(strcmp(flag, "--scenario") == 0)
+			settings->scenario = value;
+		else if(strcmp(flag, "--steps") == 0)
+			settings->steps = atoi(value);
+		else if(strcmp(flag, "--substeps") == 0)
+			settings->substeps = atoi(value);
+		else if(strcmp(flag, "--workers") == 0)
+			settings->workers = atoi(value);
+		else if(strcmp(flag, "--cloth") == 0)
+			settings->cloth_size = atoi(value);
+		else if(strcmp(flag, "--max-particles") == 0)
+			settings->max_particles = atoi(value);
+		else if(strcmp(flag, "--seed") == 0)
+			settings->seed = (unsigned int)strtoul(value, NULL, 10);
+		else if(strcmp(flag, "--reorder") == 0)
+			settings->reorder_interval = atoi(value);
+		else if(strcmp(flag, "--trace") == 0)
+			settings->trace_path = value;
+		else if(strcmp(flag, "--histogram") == 0)
+			settings->histogram_path = value;
+		else if(strcmp(flag, "--broadphase") == 0)
+		{
+			if(strcmp(value, "grid") == 0) settings->broadphase = DENSE_GRID;
+			else if(strcmp(value, "hash") == 0) settings->broadphase = HASHED_GRID;
+			else if(strcmp(value, "list") == 0) settings->broadphase = NEIGHBOR_LIST;
+			else return false;
+		}
+		else
+			return false;
+
+		if(takes_value)
+			a++;
+	}
+
+	// xorshift never leaves zero
+	return (settings->substeps >= 0) && (settings->workers > 0) && (settings->cloth_size > 1) && (settings->seed != 0);
+}
+
+int main(int argc, char** argv)
+{
+	BenchSettings settings = { NULL, 0, 0, 1, 50, 1000000, 1, DENSE_GRID, false, 0, CSV, NULL, NULL, false, NULL, NULL };
+	ProfileTrace trace;
+	int reported = 0;
+	bool found = false, passed = true;
+
+	if(!parse_settings(argc, argv, &settings))
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	if(settings.counting && (open_counters() == 0))
+		fprintf(stderr, "hardware counters unavailable (%s), their fields are left empty\n", counters_error());
+
+	if(settings.trace_path != NULL)
+	{
+		profile_name_thread("bench");
+		trace = create_profile_trace(0);
+		settings.trace = &trace;
+	}
+
+	if(settings.histogram_path != NULL)
+	{
+		settings.histogram_file = fopen(settings.histogram_path, "w");
+
+		if(settings.histogram_file == NULL)
+		{
+			fprintf(stderr, "could not write %s\n", settings.histogram_path);
+			return 1;
+		}
+
+		fprintf(settings.histogram_file, "series,low_ms,high_ms,count,cumulative\n");
+	}
+
+	if(settings.format == JSON)
+		print_json_header(&settings);
+	else
+		print_csv_header(&settings);
+
+	for(int s = 0; s < SCENARIO_COUNT; s++)
+		if((settings.scenario == NULL) || (strcmp(settings.scenario, SCENARIOS[s].name) == 0))
+		{
+			passed = run_scenario(&SCENARIOS[s], &settings, &reported) && passed;
+			found = true;
+		}
+
+	if(settings.format == JSON)
+		printf("\n\t]\n}\n");
+
+	if(settings.histogram_file != NULL)
+		fclose(settings.histogram_file);
+
+	if(settings.trace != NULL)
+	{
+		if(!write_profile_trace(settings.trace, settings.trace_path))
+			fprintf(stderr, "could not write %s\n", settings.trace_path);
+
+		dealloc_profile_trace(settings.trace);
+	}
+
+	if(!found)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	return passed ? 0 : 1;
+}
@@ -1,43 +1,211 @@
 #include "headers/circle.h"
-#include "headers/raylib.h"
+#include <string.h>
+
+static void realloc_circle_arrays(Circles* circles)
+{
+	size_t n = circles->capacity;
+
+	circles->x = realloc(circles->x, n * sizeof(float));
+	circles->y = realloc(circles->y, n * sizeof(float));
+	circles->previous_x = realloc(circles->previous_x, n * sizeof(float));
+	circles->previous_y = realloc(circles->previous_y, n * sizeof(float));
+	circles->radius = realloc(circles->radius, n * sizeof(float));
+	circles->status = realloc(circles->status, n * sizeof(unsigned char));
+	circles->acceleration_x = realloc(circles->acceleration_x, n * sizeof(float));
+	circles->acceleration_y = realloc(circles->acceleration_y, n * sizeof(float));
+	circles->rest = realloc(circles->rest, n * sizeof(unsigned char));
+	circles->color = realloc(circles->color, n * sizeof(Color));
+	circles->slot_of = realloc(circles->slot_of, n * sizeof(int));
+}
 
 Circles create_circles()
 {
-	Circles circles;
+	Circles circles = { 0 };
 
 	circles.size = 0;
-	circles.capacity = sizeof(VerletCirlce);
-	circles.circle = malloc(circles.capacity);
+	circles.capacity = 1;
+	circles.layout = 0;
+	realloc_circle_arrays(&circles);
 
-	return circles;
-}
+	circles.slot_count = 0;
+	circles.free_slot = -1;
+	circles.slot_capacity = 1;
+	circles.slot_index = malloc(sizeof(int) * circles.slot_capacity);
+	circles.slot_generation = malloc(sizeof(unsigned int) * circles.slot_capacity);
 
-void draw_circles(Circles* circles)
-{
-	int c = 0;
-	
-	for(VerletCirlce* vc = circles->circle; c < circles->size; c++, vc = (circles->circle + c))
-		DrawCircleSector(vc->current_position, vc->radius, 0, 360, 1, vc->color);
+	return circles;
 }
 
 void resize_circles(Circles* circles)
 {   
 	circles->capacity *= 2;
-	circles->circle = realloc(circles->circle, circles->capacity);
+	realloc_circle_arrays(circles);
+}
+
+static void move_circle(Circles* circles, int from, int to)
+{
+	circles->x[to] = circles->x[from];
+	circles->y[to] = circles->y[from];
+	circles->previous_x[to] = circles->previous_x[from];
+	circles->previous_y[to] = circles->previous_y[from];
+	circles->radius[to] = circles->radius[from];
+	circles->status[to] = circles->status[from];
+	circles->acceleration_x[to] = circles->acceleration_x[from];
+	circles->acceleration_y[to] = circles->acceleration_y[from];
+	circles->rest[to] = circles->rest[from];
+	circles->color[to] = circles->color[from];
+	circles->slot_of[to] = circles->slot_of[from];
+	circles->slot_index[circles->slot_of[to]] = to;
 }
 
+// swap remove, the last circle fills the hole so deleting is O(1). indicies change, handles do not
 void delete_verlet_circle(Circles* circles, int position)
 {
-	for(int i = position; i < circles->size; i++)
-		circles->circle[i] = circles->circle[i + 1];
+	int slot = circles->slot_of[position];
+	int last = --circles->size;
+
+	circles->layout++;
+	if(position != last)
+		move_circle(circles, last, position);
+
+	circles->slot_generation[slot]++;
+	circles->slot_index[slot] = circles->free_slot;
+	circles->free_slot = slot;
+}
+
+static int compare_descending(const void* a, const void* b)
+{
+	return (*(const int*)b - *(const int*)a);
+}
+
+// deletes many circles in one compaction. going from the highest position down, the circle swapped into a hole is never one still waiting to be deleted
+void delete_verlet_circles(Circles* circles, int* positions, int count)
+{
+	qsort(positions, count, sizeof(int), compare_descending);
+
+	for(int i = 0; i < count; i++)
+		delete_verlet_circle(circles, positions[i]);
+}
+
+void delete_circle_handle(Circles* circles, CircleHandle handle)
+{
+	int position = circle_index(circles, handle);
+
+	if(position != -1)
+		delete_verlet_circle(circles, position);
+}
+
+static int take_slot(Circles* circles)
+{
+	if(circles->free_slot != -1)
+	{
+		int slot = circles->free_slot;
+		circles->free_slot = circles->slot_index[slot];
+		return slot;
+	}
 
-	circles->size--;
+	if(circles->slot_count == circles->slot_capacity)
+	{
+		circles->slot_capacity *= 2;
+		circles->slot_index = realloc(circles->slot_index, sizeof(int) * circles->slot_capacity);
+		circles->slot_generation = realloc(circles->slot_generation, sizeof(unsigned int) * circles->slot_capacity);
+	}
+
+	circles->slot_generation[circles->slot_count] = 0;
+	return circles->slot_count++;
 }
 
-void add_verlet_circle(Circles* circles, VerletCirlce circle)
+CircleHandle add_verlet_circle(Circles* circles, VerletCirlce circle)
 {
-	if((circles->size * sizeof(VerletCirlce)) == circles->capacity)
+	if(circles->size == circles->capacity)
 		resize_circles(circles);
 
-	circles->circle[circles->size++] = circle;
-}
\ No newline at end of file
+	int i = circles->size++;
+	int slot = take_slot(circles);
+
+	circles->x[i] = circle.current_position.x;
+	circles->y[i] = circle.current_position.y;
+	circles->previous_x[i] = circle.previous_position.x;
+	circles->previous_y[i] = circle.previous_position.y;
+	circles->radius[i] = circle.radius;
+	circles->status[i] = circle.status;
+	circles->acceleration_x[i] = circle.acceleration.x;
+	circles->acceleration_y[i] = circle.acceleration.y;
+	circles->rest[i] = 0;
+	circles->color[i] = circle.color;
+	circles->slot_of[i] = slot;
+	circles->slot_index[slot] = i;
+
+	return (CircleHandle){ slot, circles->slot_generation[slot] };
+}
+
+CircleHandle circle_handle(Circles* circles, int position)
+{
+	if((position < 0) || (position >= circles->size))
+		return NO_CIRCLE;
+
+	int slot = circles->slot_of[position];
+	return (CircleHandle){ slot, circles->slot_generation[slot] };
+}
+
+int circle_index(Circles* circles, CircleHandle handle)
+{
+	if((handle.slot < 0) || (handle.slot >= circles->slot_count) || (circles->slot_generation[handle.slot] != handle.generation))
+		return -1;
+
+	return circles->slot_index[handle.slot];
+}
+
+static void permute_array(void* array, void* scratch, size_t element_size, const int* order, int size)
+{
+	char* from = array;
+	char* to = scratch;
+
+	for(int i = 0; i < size; i++)
+		memcpy((to + (i * element_size)), (from + (order[i] * element_size)), element_size);
+
+	memcpy(array, scratch, (size * element_size));
+}
+
+void permute_circles(Circles* circles, const int* order)
+{
+	int n = circles->size;
+	size_t widest = (sizeof(Color) > sizeof(float)) ? sizeof(Color) : sizeof(float);
+	void* scratch = malloc(n * widest);
+
+	circles->layout++;
+
+	permute_array(circles->x, scratch, sizeof(float), order, n);
+	permute_array(circles->y, scratch, sizeof(float), order, n);
+	permute_array(circles->previous_x, scratch, sizeof(float), order, n);
+	permute_array(circles->previous_y, scratch, sizeof(float), order, n);
+	permute_array(circles->radius, scratch, sizeof(float), order, n);
+	permute_array(circles->status, scratch, sizeof(unsigned char), order, n);
+	permute_array(circles->acceleration_x, scratch, sizeof(float), order, n);
+	permute_array(circles->acceleration_y, scratch, sizeof(float), order, n);
+	permute_array(circles->rest, scratch, sizeof(unsigned char), order, n);
+	permute_array(circles->color, scratch, sizeof(Color), order, n);
+	permute_array(circles->slot_of, scratch, sizeof(int), order, n);
+
+	for(int i = 0; i < n; i++)
+		circles->slot_index[circles->slot_of[i]] = i;
+
+	free(scratch);
+}
+
+void dealloc_circles(Circles* circles)
+{
+	free(circles->x);
+	free(circles->y);
+	free(circles->previous_x);
+	free(circles->previous_y);
+	free(circles->radius);
+	free(circles->status);
+	free(circles->acceleration_x);
+	free(circles->acceleration_y);
+	free(circles->rest);
+	free(circles->color);
+	free(circles->slot_of);
+	free(circles->slot_index);
+	free(circles->slot_generation);
+}
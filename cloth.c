@@ -1,61 +1,31 @@
 #include "headers/raylib.h"
 #include "headers/raymath.h"
-#include "headers/physics.h"
 #include "headers/circle.h"
 #include "headers/link.h"
+#include "headers/world.h"
+#include "headers/render.h"
+#include "headers/sim_thread.h"
 #include <stdlib.h>
 
 const int SCRW = 900, SCRH = 900;
 const int FPS = 60;
 
-const int ROW = 50, COL = 50;
+const int CLOTH_ROW = 50, CLOTH_COL = 50;
 
 const int XPAD = 100;
 const int YPAD = 30;
 
-const int XDIST = ((SCRW - (2 * XPAD)) / (COL - 1));
+const int XDIST = ((SCRW - (2 * XPAD)) / (CLOTH_COL - 1));
 const int YDIST = 1;
 
-// directly affects tension of links
-const int SUB_STEPS = 5;
+// directly affects tension of links, doubled since links are no longer added twice
+const int SUB_STEPS = 10;
+const int WORKERS = 4;
 
 const Vector2 WORLD_GRAVITY = { 0, 2000.0f };
 
-void update_circles(Circles* circles, int* grabbed_link_pos)
-{
-	// slowdown scale factor
-	const float DAMP = 0.975f;
-
-	int i = 0;
-	for(VerletCirlce* vc = circles->circle; i < circles->size; i++, vc = (circles->circle + i))
-	{
-		if(CheckCollisionPointCircle(GetMousePosition(), vc->current_position, vc->radius) && !(IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) && (i > ROW))
-			*grabbed_link_pos = i;
-		
-		if(vc->status == FREE)
-		{
-			apply_gravity(vc, WORLD_GRAVITY, GetFrameTime());
-			update_position(vc, DAMP, GetFrameTime());
-		}
-	}
-}
-
-void update_links(Chain* chain)
-{
-	const float MAX_LINK_DIST = 100.0f;
-
-	int l = 0;
-	for(Link* link = chain->link; l < chain->size; l++, link = (chain->link + l))
-	{
-		Vector2 starting_position = link->circle1->current_position, 
-				ending_position = link->circle2->current_position;
-		
-		if((Vector2Distance(starting_position, ending_position) >= MAX_LINK_DIST) || ((IsMouseButtonDown(MOUSE_BUTTON_LEFT)) && (CheckCollisionPointLine(GetMousePosition(), starting_position, ending_position, 5))))
-			delete_link(chain, l);
-		
-		maintain_link(link);
-	}   
-}
+// slowdown scale factor
+const float DAMP = 0.975f;
 
 void init_circles(Circles* circles)
 {
@@ -63,8 +33,8 @@ void init_circles(Circles* circles)
  
 	Vector2 vc_position = { XPAD, YPAD };
 	
-	for(int r = 0; r < ROW; r++, vc_position = (Vector2){ XPAD, (YDIST * r) })
-		for(int c = 0; c < COL; (vc_position.x += XDIST), c++)
+	for(int r = 0; r < CLOTH_ROW; r++, vc_position = (Vector2){ XPAD, (YDIST * r) })
+		for(int c = 0; c < CLOTH_COL; (vc_position.x += XDIST), c++)
 		{
 			VerletCirlce verlet_circle;
 
@@ -80,12 +50,12 @@ void init_circles(Circles* circles)
 
 void init_chain(Chain* chain, Circles* circles)
 {
-	for(int r = 0; r < ROW; r++)
+	for(int r = 0; r < CLOTH_ROW; r++)
 	{
-		for(int c = 0; c < COL; c++)
+		for(int c = 0; c < CLOTH_COL; c++)
 		{
 			// one dimensional index representation of  2d array
-			int i_index = (r * ROW) + c;
+			int i_index = (r * CLOTH_ROW) + c;
 
 			for(int dx = -1; dx <= 1; dx++)
 			{
@@ -94,26 +64,27 @@ void init_chain(Chain* chain, Circles* circles)
 					// neighboring row and columns
 					int nr = (r + dx);
 					int nc = (c + dy);
-					int j_index = (nr * ROW) + nc; 
+					int j_index = (nr * CLOTH_ROW) + nc; 
 					
-					if((nr >= ROW || nr < 0) || (nc >= COL || nc < 0) || ((nr == r) && (nc == c))) 
+					// each pair is linked once, from its lower index
+					if((nr >= CLOTH_ROW || nr < 0) || (nc >= CLOTH_COL || nc < 0) || (j_index <= i_index)) 
 						continue;
 
 					Link link;
 
-					link.circle1 = (circles->circle + i_index);
-					link.circle2 = (circles->circle + j_index);
+					link.circle1 = circle_handle(circles, i_index);
+					link.circle2 = circle_handle(circles, j_index);
 
 					if(r == nr)
 					{
 						link.target_distance = XDIST;
-						add_link(chain, link);
+						add_link(chain, circles, link);
 					}
 
 					else if(c == nc)
 					{
-						link.target_distance = (SCRW - (2 * YPAD)) / (ROW - 1.0f);
-						add_link(chain, link);
+						link.target_distance = (SCRW - (2 * YPAD)) / (CLOTH_ROW - 1.0f);
+						add_link(chain, circles, link);
 					}
 				}
 			}
@@ -121,10 +92,17 @@ void init_chain(Chain* chain, Circles* circles)
 	}
 }
 
-void pull_cloth(Circles* circles, int index)
+// the held circle is picked on the simulation thread, the cursor only says whether it is held
+void send_input(SimThread* sim)
 {
-	if((index != -1) && (IsMouseButtonDown(MOUSE_BUTTON_RIGHT))) 
-		circles->circle[index].current_position = GetMousePosition(); 
+	SimCommand command = { .type = SIM_INPUT };
+
+	command.input.cursor = GetMousePosition();
+	command.input.cut = IsMouseButtonDown(MOUSE_BUTTON_LEFT);
+	command.input.grabbed = NO_CIRCLE;
+	command.grab = IsMouseButtonDown(MOUSE_BUTTON_RIGHT);
+
+	sim_send(sim, command);
 }
 
 void init()
@@ -134,43 +112,87 @@ void init()
 	InitWindow(SCRW, SCRH, "Cloth Demo");
 }
 
-void deinit(VerletCirlce* alloc_circle_mem, Link* alloc_link_mem)
+void deinit(VerletWorld* world, CircleBatch* batch, LinkBatch* link_batch)
 {
-	free(alloc_circle_mem);
-	free(alloc_link_mem);
+	dealloc_link_batch(link_batch);
+	dealloc_circle_batch(batch);
+	dealloc_world(world);
 	CloseWindow();
 }
 
 int main()
 {
-	Chain chain = create_chain();
-	Circles circles = create_circles();
+	VerletWorld world = create_world();
 
-	int grabbed_link_index = -1;
 	bool show_circles = false;
+	bool show_profile = false;
+	ProfileSummary profile = create_profile_summary(0.5f);
+
+	// VERLET_TRACE=file.json records the session as a chrome trace, written on T and at exit
+	const char* trace_path = getenv("VERLET_TRACE");
+	ProfileTrace trace = { 0 };
+
+	profile_name_thread("render");
+
+	if(trace_path != NULL)
+		trace = create_profile_trace(0);
 
 	init();
-	init_circles(&circles);
-	init_chain(&chain, &circles);
+	world.gravity = WORLD_GRAVITY;
+	world.damping = DAMP;
+	world.link_iterations = SUB_STEPS;
+	world.worker_count = WORKERS;
+	init_circles(&world.circles);
+	init_chain(&world.chain, &world.circles);
+	CircleBatch batch = create_circle_batch(world.circles.size);
+	LinkBatch link_batch = create_link_batch(LIGHTGRAY);
+
+	SimThread* sim = start_sim_thread(&world, 1);
 
 	while(!WindowShouldClose())
 	{
-		for(int i = 0; i < SUB_STEPS; i++)
-			update_links(&chain);
-		
-		update_circles(&circles, &grabbed_link_index);
-		pull_cloth(&circles, grabbed_link_index);
+		send_input(sim);
 		
 		if(IsKeyPressed(KEY_C))
 			show_circles = !show_circles;
 
+		if(IsKeyPressed(KEY_P))
+			show_profile = !show_profile;
+
+		if(IsKeyPressed(KEY_H))
+			write_profile_histograms(&profile, "latency.csv");
+
+		if(trace_path != NULL)
+		{
+			poll_profile_trace(&trace);
+
+			if(IsKeyPressed(KEY_T))
+				write_profile_trace(&trace, trace_path);
+		}
+
 		BeginDrawing();
 			ClearBackground(BLACK);
-			if(show_circles) draw_circles(&circles);
-			draw_links(&chain);
+
+			const WorldSnapshot* snapshot = acquire_snapshot(sim);
+			if(show_circles) draw_circle_batch(&batch, snapshot);
+			draw_link_batch(&link_batch, snapshot);
+			release_snapshot(sim);
+
 			DrawFPS(0, 0);
+
+			profile_collect(&profile);
+			if(show_profile) draw_profile_overlay(&profile, 5, SCRH - PROFILE_OVERLAY_HEIGHT - 5);
 		EndDrawing();
 	}
 
+	stop_sim_thread(sim);
+
+	if(trace_path != NULL)
+	{
+		write_profile_trace(&trace, trace_path);
+		dealloc_profile_trace(&trace);
+	}
+
+	deinit(&world, &batch, &link_batch);
 	return 0;    
-}
\ No newline at end of file
+}
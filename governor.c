@@ -0,0 +1,80 @@
+#include "headers/governor.h"
+#include <math.h>
+
+// how much of each new step cost goes into the smoothed cost
+static const float SMOOTHING = 0.1f;
+
+// spawning halved below this goes straight to min_spawn_scale, and comes back from there at this
+static const float SPAWN_FLOOR = 0.125f;
+
+FrameGovernor create_governor(float budget_ms, int min_substeps, int max_substeps)
+{
+	FrameGovernor governor;
+
+	governor.budget_ms = budget_ms;
+	governor.relax = 0.7f;
+	governor.min_substeps = (min_substeps > 0) ? min_substeps : 1;
+	governor.max_substeps = (max_substeps > governor.min_substeps) ? max_substeps : governor.min_substeps;
+	governor.min_spawn_scale = 0;
+	governor.min_circle_cap = 0;
+	governor.settle_steps = 30;
+
+	governor.cost_ms = -1;
+	governor.substeps = governor.max_substeps;
+	governor.spawn_scale = 1;
+	governor.circle_cap = NO_CIRCLE_CAP;
+	governor.since_change = 0;
+
+	return governor;
+}
+
+// called after every step with what it cost and how many circles it ran
+void govern(FrameGovernor* governor, float step_ms, int circle_count)
+{
+	if(governor->cost_ms < 0)
+		governor->cost_ms = step_ms;
+	else
+		governor->cost_ms += (step_ms - governor->cost_ms) * SMOOTHING;
+
+	if((++governor->since_change < governor->settle_steps) || (governor->cost_ms <= 0))
+		return;
+
+	float cost = governor->cost_ms, relaxed = governor->relax * governor->budget_ms;
+
+	if(cost > governor->budget_ms)
+	{
+		if(governor->spawn_scale > governor->min_spawn_scale)
+		{
+			float halved = governor->spawn_scale * 0.5f;
+			governor->spawn_scale = (halved < SPAWN_FLOOR) ? governor->min_spawn_scale : fmaxf(governor->min_spawn_scale, halved);
+		}
+		else if(governor->substeps > governor->min_substeps)
+			governor->substeps--;
+		else
+		{
+			// circles are dropped down to what the budget holds, assuming cost grows with the count
+			int cap = fmaxf(governor->min_circle_cap, (circle_count * (governor->budget_ms / cost)));
+
+			if((governor->circle_cap != NO_CIRCLE_CAP) && (cap >= governor->circle_cap))
+				return;
+
+			governor->circle_cap = cap;
+		}
+	}
+	else if(cost < relaxed)
+	{
+		// a substep only comes back once the step would still cost under the relaxed budget with it
+		if(governor->circle_cap != NO_CIRCLE_CAP)
+			governor->circle_cap = NO_CIRCLE_CAP;
+		else if((governor->substeps < governor->max_substeps) && ((cost * (governor->substeps + 1) / governor->substeps) < relaxed))
+			governor->substeps++;
+		else if(governor->spawn_scale < 1)
+			governor->spawn_scale = fminf(1, fmaxf(SPAWN_FLOOR, (governor->spawn_scale * 2)));
+		else
+			return;
+	}
+	else
+		return;
+
+	governor->since_change = 0;
+}
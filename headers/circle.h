@@ -1,15 +1,17 @@
 #ifndef CIRCLE_H
 #define CIRCLE_H
 
-#include "raylib.h"
+#include "verlet_math.h"
 #include <stdlib.h>
 
 typedef enum
 {
 	FREE = 0,
 	SUSPENDED = 1,
+	SLEEPING = 2,       // at rest, held still until something awake runs into it
 } Status;
 
+// a single circle, used to describe a circle going into the store
 typedef struct
 {
 	Color color;
@@ -20,17 +22,58 @@ typedef struct
 	Vector2 previous_position;
 } VerletCirlce;
 
+// stable name for a circle. the slot survives the store growing, reordering and compacting, and the
+// generation tells a live circle apart from a later one reusing a deleted circle's slot
+typedef struct
+{
+	int slot;
+	unsigned int generation;
+} CircleHandle;
+
+static const CircleHandle NO_CIRCLE = { -1, 0 };
+
+// structure of arrays circle store, the collision and integration loops only touch the arrays they read
 typedef struct
 {
 	int size;
 	size_t capacity;
-	VerletCirlce* circle;
+	unsigned int layout;    // bumped whenever circles move to other indicies, appending does not count
+
+	// hot, read by the narrowphase and integrator
+	float* x;
+	float* y;
+	float* previous_x;
+	float* previous_y;
+	float* radius;
+	unsigned char* status;
+
+	// warm, read by the integrator only
+	float* acceleration_x;
+	float* acceleration_y;
+	unsigned char* rest;    // substeps in a row the circle has barely moved, it sleeps once this reaches SLEEP_SUBSTEPS
+
+	// cold, read when drawing
+	Color* color;
+
+	// slot map, slot_of follows each circle through moves and slot_index points a slot back at its circle
+	int* slot_of;
+	int* slot_index;        // circle index of a live slot, next free slot of a dead one
+	unsigned int* slot_generation;
+	int slot_count;
+	int free_slot;          // head of the free slot list, -1 when empty
+	size_t slot_capacity;
 } Circles;
 
 Circles create_circles();
-void draw_circles(Circles* circles);
 void resize_circles(Circles* circles);
 void delete_verlet_circle(Circles* circles, int position);
-void add_verlet_circle(Circles* circles, VerletCirlce circle);
+void delete_circle_handle(Circles* circles, CircleHandle handle);
+void delete_verlet_circles(Circles* circles, int* positions, int count);
+CircleHandle add_verlet_circle(Circles* circles, VerletCirlce circle);
+CircleHandle circle_handle(Circles* circles, int position);
+int circle_index(Circles* circles, CircleHandle handle);
+// reorders the store so circle i becomes the circle that was at order[i]
+void permute_circles(Circles* circles, const int* order);
+void dealloc_circles(Circles* circles);
 
-#endif
\ No newline at end of file
+#endif
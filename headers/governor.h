@@ -0,0 +1,32 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include <stdbool.h>
+
+#define NO_CIRCLE_CAP -1
+
+// keeps the cost of a step under a budget by trading quality and growth for frame rate. over budget it cuts spawning
+// down to min_spawn_scale, then once that is reached substeps down to min_substeps, and only then caps the circle count.
+// well under budget it gives them back in the opposite order, one stage at a time. decisions are spaced settle_steps
+// apart so each one shows in the smoothed cost first
+typedef struct
+{
+	float budget_ms;        // step cost to stay under
+	float relax;            // fraction of the budget the cost has to fall under before anything is given back
+	int min_substeps;
+	int max_substeps;
+	float min_spawn_scale;  // spawning is throttled down to this fraction of the asked rate, 0 stops it
+	int min_circle_cap;     // the cap never drops below this many circles
+	int settle_steps;
+
+	float cost_ms;          // smoothed step cost
+	int substeps;           // substeps to run the next step with
+	float spawn_scale;      // fraction of the asked spawn rate allowed
+	int circle_cap;         // circles allowed, NO_CIRCLE_CAP for no limit
+	int since_change;       // steps since the last decision
+} FrameGovernor;
+
+FrameGovernor create_governor(float budget_ms, int min_substeps, int max_substeps);
+void govern(FrameGovernor* governor, float step_ms, int circle_count);
+
+#endif
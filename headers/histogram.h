@@ -0,0 +1,41 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+// log-linear latency histogram in nanoseconds, hdr style. values below HISTOGRAM_SUB_BUCKETS are exact, above that every
+// power of two is split into HISTOGRAM_SUB_BUCKETS buckets, so any value is off by at most 1 / HISTOGRAM_SUB_BUCKETS
+#define HISTOGRAM_SUB_BUCKETS 32
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_MAX_BITS 40       // values from 2^40ns, about 18 minutes, land in the last bucket
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS * (HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1))
+
+typedef struct
+{
+	unsigned int counts[HISTOGRAM_BUCKETS];
+	long long count;
+	long long max;
+} Histogram;
+
+// the last one to two windows of values. records go into current, which becomes previous once a window has passed,
+// so the tail always reflects recent frames and a stutter ages out instead of being averaged away
+typedef struct
+{
+	Histogram current;
+	Histogram previous;
+	long long window_ns;
+	long long window_start;
+} RollingHistogram;
+
+void clear_histogram(Histogram* histogram);
+void record_histogram(Histogram* histogram, long long value);
+void merge_histogram(Histogram* into, const Histogram* from);
+long long histogram_percentile(const Histogram* histogram, double percentile);
+bool write_histogram_csv(FILE* file, const char* series, const Histogram* histogram);
+
+RollingHistogram create_rolling_histogram(float window_seconds, long long now);
+void record_rolling_histogram(RollingHistogram* rolling, long long value, long long now);
+void rolling_histogram_view(const RollingHistogram* rolling, Histogram* view);
+
+#endif
@@ -3,24 +3,52 @@
 
 #include "circle.h"
 
+// a single link, used to describe a link going into the chain
 typedef struct
 {
-	VerletCirlce* circle1;
-	VerletCirlce* circle2;
+	CircleHandle circle1;
+	CircleHandle circle2;
 	float target_distance;
 } Link;
 
+// structure of arrays link store. the solver streams circle indicies, target distances and the alive mask,
+// the handles are only read to resolve the indicies again after circles moved in their store
 typedef struct
 {
-	int size;
-	Link* link;
+	int size;               // links in the arrays, alive or dead
+	int alive_count;
 	size_t capacity;
+	unsigned int layout;    // circle layout the indicies were resolved against
+	unsigned int compactions;
+
+	// hot
+	int* circle1;
+	int* circle2;
+	float* target_distance;
+	unsigned char* alive;
+
+	// cold
+	CircleHandle* handle1;
+	CircleHandle* handle2;
+
+	// live links grouped by color, no two links of a color share a circle so a color can be solved in parallel
+	int color_count;
+	int* color_start;
+	int* colored;
+	int colored_size;       // chain size the coloring was built for
+	unsigned int colored_compactions;
 } Chain;
 
+// the last color collects links that found no free color, and is solved on one thread
+#define LINK_COLORS 64
+
 Chain create_chain();
-void draw_links(Chain* chain);
 void resize_chain(Chain* chain);
-void add_link(Chain* chain, Link link);
+void add_link(Chain* chain, Circles* circles, Link link);
 void delete_link(Chain* chain, int position);
+void sync_chain(Chain* chain, Circles* circles);
+void compact_chain(Chain* chain);
+void color_chain(Chain* chain, int circle_count);
+void dealloc_chain(Chain* chain);
 
-#endif
\ No newline at end of file
+#endif
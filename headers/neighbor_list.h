@@ -0,0 +1,46 @@
+#ifndef NEIGHBOR_LIST_H
+#define NEIGHBOR_LIST_H
+
+#include "verlet_math.h"
+#include "circle.h"
+#include "physics.h"
+#include "spatial_partition.h"
+
+// candidate pairs found with a skin margin added to the contact distance. while no circle has moved more than half
+// the skin since the build, no pair outside the list can touch, so the list stands in for the grid across substeps.
+// pairs are kept per owner cell in the grid's group order, and an owner's pairs only reach into its half stencil
+// as of the build, so the groups stay safe to collide in parallel however far circles have since moved
+typedef struct
+{
+	float skin;
+
+	int* group_start;       // owner cells per group, copied from the grid
+	int owner_count;
+	int* row_start;         // rows of each owner cell
+	int* row_circle;        // the circle a row collides against its candidates
+	int* candidate_start;   // candidates of each row
+	int* candidates;
+	int row_count;
+	int candidate_count;
+	size_t owner_capacity;
+	size_t row_capacity;
+	size_t candidate_capacity;
+
+	// state at the last build
+	float* anchor_x;
+	float* anchor_y;
+	size_t anchor_capacity;
+	int circle_count;
+	unsigned int layout;
+	float built_skin;
+	int builds;
+} NeighborList;
+
+NeighborList create_neighbor_list(float skin);
+bool neighbor_list_stale(NeighborList* list, Circles* circles);
+void build_neighbor_list(NeighborList* list, Grid* grid, Circles* circles);
+int neighbor_group_size(NeighborList* list, int group);
+void neighbor_collide_group(NeighborList* list, Circles* circles, int group, int begin, int end);
+void dealloc_neighbor_list(NeighborList* list);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdbool.h>
+
+// hardware counters of the calling thread through perf_event_open. each thread opens its own group on first use and
+// keeps it until close_counters, which threads of the library call before they exit. machines without the counters, containers that forbid them and other platforms read -1
+
+typedef enum
+{
+	COUNTER_CYCLES = 0,
+	COUNTER_INSTRUCTIONS,
+	COUNTER_L1D_MISSES,     // l1 data cache read misses
+	COUNTER_LLC_MISSES,     // last level cache misses
+	COUNTER_BRANCH_MISSES,
+	COUNTER_COUNT,
+} CounterKind;
+
+typedef struct
+{
+	long long values[COUNTER_COUNT];    // -1 for a counter that could not be opened
+} CounterSample;
+
+int open_counters();
+bool read_counters(CounterSample* sample);
+void close_counters();
+const char* counter_name(CounterKind kind);
+const char* counters_error();
+
+#endif
@@ -2,14 +2,22 @@
 #define VERLET_PHYSICS_H_
 
 #include <stdlib.h>
-#include "raylib.h"
+#include "verlet_math.h"
 #include "circle.h"
 #include "link.h"
 
-void handle_border_collision(VerletCirlce* circle, Vector2 constraint_center, Vector2 world_gravity, float constraint_radius);
-void handle_verlet_circle_collision(VerletCirlce* circle1, VerletCirlce* circle2);
-void update_position(VerletCirlce* circle, float slow_down_scale, float dt);
-void apply_gravity(VerletCirlce* circle, Vector2 world_gravity, float dt);
-void maintain_link(Link* link);
+void handle_border_collision(Circles* circles, int i, Vector2 constraint_center, Vector2 world_gravity, float constraint_radius);
+void handle_verlet_circle_collision(Circles* circles, int i, int j);
+void handle_verlet_circle_batch(Circles* circles, int i, const int* candidates, int count);
+void update_position(Circles* circles, int i, float slow_down_scale, float dt);
+void apply_gravity(Circles* circles, int i, Vector2 world_gravity, float dt);
+void maintain_link(Circles* circles, int i, int j, float target_distance);
+void update_rest(Circles* circles, int i);
+void wake_circle(Circles* circles, int i);
+bool circle_moving(Circles* circles, int i);
+void wake_on_support_loss(Circles* circles, int sleeper, int mover, Vector2 gravity);
+bool outside_border(Circles* circles, int i, Vector2 constraint_center, float constraint_radius);
+bool circles_overlap(Vector2 center1, float radius1, Vector2 center2, float radius2);
+bool point_near_segment(Vector2 point, Vector2 start, Vector2 end, float threshold);
 
-#endif
\ No newline at end of file
+#endif
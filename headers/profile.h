@@ -0,0 +1,142 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "histogram.h"
+
+// scoped timers around the hot paths. every thread records into a ring of its own, so recording takes no lock, and a
+// reader sums the rings up for an overlay or drains them into a trace. building without VERLET_PROFILE compiles every
+// PROFILE_SCOPE away
+
+typedef enum
+{
+	PROFILE_STEP = 0,
+	PROFILE_SUBSTEP,        // recorded only while a trace is being taken
+	PROFILE_GRID_CLEAR,
+	PROFILE_GRID_INSERT,
+	PROFILE_NEIGHBORS,      // neighbor list gathering
+	PROFILE_INTEGRATE,
+	PROFILE_BORDER,
+	PROFILE_NARROWPHASE,
+	PROFILE_LINKS,
+	PROFILE_RENDER,
+	PROFILE_ZONE_COUNT,
+} ProfileZone;
+
+#define PROFILE_THREADS 32      // rings there are, a thread finding none free has its events counted as unrecorded
+#define PROFILE_EVENTS 16384    // events a ring holds, a power of two
+
+// fields are atomic as the reader may catch a slot while its owner laps the ring and writes it again
+typedef struct
+{
+	atomic_int zone;
+	atomic_llong start;
+	atomic_llong end;
+	atomic_int step;        // world step and substep of step and substep events, -1 for the rest
+	atomic_int substep;
+} ProfileEvent;
+
+typedef struct
+{
+	ProfileEvent events[PROFILE_EVENTS];
+	atomic_ulong head;      // events ever written, only its owner writes
+	int thread;             // index of the ring, in the order threads first recorded
+	char name[32];          // given before the ring is published, never changed after
+	atomic_bool in_use;     // false once its thread released it, for the next thread of the same name to take over
+} ProfileBuffer;
+
+// totals of the events read so far, turned into an average per frame once a window has passed
+typedef struct
+{
+	unsigned long read[PROFILE_THREADS];    // how far into each ring this summary has read
+	long long window_ns;
+	long long window_start;
+	int window_frames;
+	long long total_ns[PROFILE_ZONE_COUNT];
+	int calls[PROFILE_ZONE_COUNT];
+
+	float ms_per_frame[PROFILE_ZONE_COUNT];     // averages of the last window
+	float calls_per_frame[PROFILE_ZONE_COUNT];
+
+	// the tail the averages hide, time between collects and time of each world step
+	RollingHistogram frame_times;
+	RollingHistogram step_times;
+	long long last_frame;
+} ProfileSummary;
+
+// a plain copy of an event, kept by a trace for as long as the session runs
+typedef struct
+{
+	int thread;
+	int zone;
+	long long start;
+	long long end;
+	int step;
+	int substep;
+} TraceEvent;
+
+// every event recorded while the trace is open, drained from the rings before they wrap and written as chrome
+// trace-event json, which chrome://tracing and ui.perfetto.dev both load
+typedef struct
+{
+	unsigned long read[PROFILE_THREADS];
+	TraceEvent* events;
+	int count;
+	int capacity;
+	int max_events;         // events past this are counted as dropped rather than kept
+	long long dropped;      // events lost to a full trace, to a ring wrapping before it was drained or to a thread without a ring
+	long long unrecorded;   // events from threads without a ring as of the last poll
+	long long origin;       // timestamps are written relative to when the trace was opened
+} ProfileTrace;
+
+long long profile_now();
+void profile_record(ProfileZone zone, long long start, long long end);
+void profile_record_step(ProfileZone zone, long long start, long long end, int step, int substep);
+void profile_name_thread(const char* name);
+void profile_release_thread();
+const char* profile_zone_name(ProfileZone zone);
+int profile_thread_count();
+ProfileBuffer* profile_buffer(int thread);
+
+ProfileSummary create_profile_summary(float window_seconds);
+bool profile_collect(ProfileSummary* summary);
+bool write_profile_histograms(const ProfileSummary* summary, const char* path);
+
+ProfileTrace create_profile_trace(int max_events);
+bool profile_tracing();
+void poll_profile_trace(ProfileTrace* trace);
+bool write_profile_trace(ProfileTrace* trace, const char* path);
+void dealloc_profile_trace(ProfileTrace* trace);
+
+#ifdef VERLET_PROFILE
+
+typedef struct
+{
+	ProfileZone zone;
+	long long start;
+} ProfileScope;
+
+static inline ProfileScope profile_begin(ProfileZone zone)
+{
+	return (ProfileScope){ zone, profile_now() };
+}
+
+static inline void profile_end(ProfileScope* scope)
+{
+	profile_record(scope->zone, scope->start, profile_now());
+}
+
+#define PROFILE_JOIN(a, b) a##b
+#define PROFILE_NAME(line) PROFILE_JOIN(profile_scope_, line)
+
+// times the rest of the enclosing block
+#define PROFILE_SCOPE(zone) ProfileScope PROFILE_NAME(__LINE__) __attribute__((cleanup(profile_end))) = profile_begin(zone)
+
+#else
+
+#define PROFILE_SCOPE(zone)
+
+#endif
+
+#endif
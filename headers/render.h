@@ -0,0 +1,43 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "raylib.h"
+#include "snapshot.h"
+#include "profile.h"
+
+// every circle as one textured quad in a single dynamic mesh, drawn with one call
+typedef struct
+{
+	Mesh mesh;
+	Material material;
+	int capacity;           // circles the mesh buffers hold, grown when exceeded
+} CircleBatch;
+
+// every link as a thin quad, positions are rewritten in place each frame and the index buffer only
+// references live links, compacted again when links tear
+typedef struct
+{
+	Mesh* meshes;           // each holds LINK_BATCH_LINKS links, keeping indicies within 16 bits
+	int* live_links;        // links each mesh draws
+	int mesh_count;
+	Material material;
+
+	// chain state the index buffers were compacted for
+	int built_size;
+	int built_alive;
+	unsigned int built_compactions;
+} LinkBatch;
+
+#define LINK_BATCH_LINKS 16384
+#define PROFILE_OVERLAY_LINE 12   // height of one line of the profile overlay
+#define PROFILE_OVERLAY_HEIGHT ((PROFILE_ZONE_COUNT + 2) * PROFILE_OVERLAY_LINE)
+
+CircleBatch create_circle_batch(int capacity);
+void draw_circle_batch(CircleBatch* batch, const WorldSnapshot* snapshot);
+void dealloc_circle_batch(CircleBatch* batch);
+LinkBatch create_link_batch(Color color);
+void draw_link_batch(LinkBatch* batch, const WorldSnapshot* snapshot);
+void dealloc_link_batch(LinkBatch* batch);
+void draw_profile_overlay(const ProfileSummary* summary, int x, int y);
+
+#endif
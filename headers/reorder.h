@@ -0,0 +1,12 @@
+#ifndef REORDER_H
+#define REORDER_H
+
+#include <stdint.h>
+#include "verlet_math.h"
+#include "circle.h"
+
+uint32_t morton_key(uint32_t column, uint32_t row);
+// fills order with circle indicies sorted by the z-order key of their cell, so circles close in space end up close in memory
+void morton_order(Circles* circles, Vector2 origin, float cell_size, int* order);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef SIM_THREAD_H
+#define SIM_THREAD_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "world.h"
+#include "snapshot.h"
+#include "governor.h"
+
+typedef enum
+{
+	SIM_INPUT = 0,      // cursor, cut and whether the hovered circle is held
+	SIM_SPAWN = 1,      // add a circle
+	SIM_ERASE = 2,      // erase circles overlapping a disc
+	SIM_TRIM = 3,       // drop the most recently spawned circles down to a count, then any others
+	SIM_GRAVITY = 4,
+	SIM_BORDER = 5,     // border radius
+	SIM_GOVERN = 6,     // hand the substeps to a governor, whose throttle and cap come back in the snapshots
+} SimCommandType;
+
+typedef struct
+{
+	SimCommandType type;
+	VerletInput input;
+	bool grab;          // with SIM_INPUT, pin the last circle hovered while not grabbing to the cursor
+	VerletCirlce circle;
+	Vector2 center;
+	float radius;
+	int count;
+	Vector2 gravity;
+	FrameGovernor governor;
+} SimCommand;
+
+// single producer single consumer ring, the render thread pushes and the simulation thread pops
+typedef struct
+{
+	SimCommand* commands;
+	unsigned int capacity;  // a power of two
+	atomic_uint head;       // next to pop, written by the consumer
+	atomic_uint tail;       // next to push, written by the producer
+} CommandQueue;
+
+// runs a world on its own thread. after every advance the world is copied into whichever of the two snapshots
+// the render thread is not reading, which then becomes the latest
+typedef struct
+{
+	VerletWorld* world;
+	int substeps;
+	pthread_t thread;
+	atomic_bool running;
+	CommandQueue queue;
+	CircleHandle hovered;
+	FrameGovernor governor;
+	bool governed;
+	CircleHandle* spawned;  // circles added through SIM_SPAWN, oldest first
+	int spawned_count;
+	size_t spawned_capacity;
+
+	pthread_mutex_t lock;
+	WorldSnapshot snapshots[2];
+	int latest;             // snapshot last published, -1 before the first
+	int reading;            // snapshot held by the render thread, -1 for none
+} SimThread;
+
+CommandQueue create_command_queue(unsigned int capacity);
+bool push_command(CommandQueue* queue, SimCommand command);
+bool pop_command(CommandQueue* queue, SimCommand* command);
+void dealloc_command_queue(CommandQueue* queue);
+
+SimThread* start_sim_thread(VerletWorld* world, int substeps);
+bool sim_send(SimThread* sim, SimCommand command);
+const WorldSnapshot* acquire_snapshot(SimThread* sim);
+void release_snapshot(SimThread* sim);
+void stop_sim_thread(SimThread* sim);
+
+#endif
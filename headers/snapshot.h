@@ -0,0 +1,38 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "world.h"
+#include "governor.h"
+
+// what a frame draws, copied out of the world so drawing never reads arrays the simulation is writing
+typedef struct
+{
+	int size;
+	int capacity;
+	float* x;               // interpolated positions
+	float* y;
+	float* radius;
+	Color* color;
+
+	// chain hot arrays, indicies already resolved against the circles above
+	int link_count;         // links in the arrays, alive or dead
+	int link_capacity;
+	int* circle1;
+	int* circle2;
+	unsigned char* alive;
+	int alive_links;
+	unsigned int link_compactions;
+
+	unsigned int steps;     // world steps run when the snapshot was taken
+
+	// filled in by the simulation thread, from its governor when it has one
+	int substeps;
+	float spawn_scale;
+	int circle_cap;
+} WorldSnapshot;
+
+WorldSnapshot create_snapshot();
+void snapshot_world(WorldSnapshot* snapshot, VerletWorld* world);
+void dealloc_snapshot(WorldSnapshot* snapshot);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "verlet_math.h"
+#include "circle.h"
+#include "physics.h"
+#include "spatial_partition.h"
+
+// sparse alternative to Grid for open worlds. occupied cells are found through an open addressing table keyed
+// on their (row, column), so memory follows the number of occupied cells instead of the area of the world.
+// circles are counting sorted by cell into one array the same way Grid does it
+typedef struct
+{
+	float cell_size;
+
+	uint64_t* keys;         // packed (row, column) of each table entry
+	int* slots;             // occupied cell of each table entry, -1 when empty
+	size_t table_capacity;  // power of two, kept at least twice the occupied cell count
+
+	int* cell_row;
+	int* cell_col;
+	int* cell_count;
+	int* cell_start;
+	int* cell_entry;        // table entry of each occupied cell, so clearing only touches used entries
+	int occupied_count;
+
+	int* group_start;       // occupied cells split into independent groups for parallel collision
+	int* group_cells;
+
+	int* cell_of;           // occupied cell of each circle
+	int* indicies;
+	int circle_count;       // circles in the store at the last build
+	unsigned int layout;    // layout of the store at the last build
+	size_t capacity;
+} SpatialHash;
+
+SpatialHash create_spatial_hash(float cell_size);
+void build_spatial_hash(SpatialHash* hash, Circles* circles);
+int hash_group_size(SpatialHash* hash, int group);
+void hash_collide_group(SpatialHash* hash, Circles* circles, int group, int begin, int end);
+void hash_query(SpatialHash* hash, Vector2 low, Vector2 high, CircleVisitor visit, void* context);
+void dealloc_spatial_hash(SpatialHash* hash);
+
+#endif
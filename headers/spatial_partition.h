@@ -2,36 +2,52 @@
 #define SP_H
 
 #include <stdlib.h>
-#include "raylib.h"
+#include "verlet_math.h"
 #include "circle.h"
 #include "physics.h"
 
-// for optimal preformance, let the size of a cell be the diameter of the balls you make
-static const int CSIZE = 20;
-static const float BORDER_RADIUS = 400.0;
-static const int ROW = ((BORDER_RADIUS * 2) / CSIZE), COL = ((BORDER_RADIUS * 2) / CSIZE);
-
+// cells are indexed row major (r * cols + c). circle indicies are counting sorted by cell into one array,
+// and only occupied cells get a range in it, kept in cell order so a cell's right neighbor and the three
+// cells below it are each one contiguous run
 typedef struct
 {
-	int size;
+	Vector2 start;          // top left corner of cell [0][0]
+	float cell_size;        // the largest circle diameter, so any touching pair is at most one cell apart
+	int rows;
+	int cols;
+
+	int* cell_count;        // circles per cell, zero for every cell not in occupied
+	int* cell_awake;        // free circles per cell at the build, a cell whose stencil has none is skipped
+	int* cell_start;        // offset of each occupied cell's run in indicies
+	int* occupied;          // occupied cells in cell order
+	int occupied_count;
+
+	int* group_start;       // occupied cells split into independent groups for parallel collision
+	int* group_cells;
+
+	int* cell_of;           // cell of each circle, -1 if it is off the grid
 	int* indicies;
+	int circle_count;       // circles in the store at the last build
+	unsigned int layout;    // layout of the store at the last build
 	size_t capacity;
-} IndexList;
+} Grid;
 
-void resize_index_list(IndexList* il);
-void add_circle_index(IndexList* il, int index);
+// the half stencil of a cell spans one row down and one column either side, so cells two rows or three columns apart
+// never share a circle. cells are split into CELL_GROUPS groups by row and column, each group collides in parallel
+#define GROUP_ROWS 2
+#define GROUP_COLS 3
+#define CELL_GROUPS (GROUP_ROWS * GROUP_COLS)
 
-typedef struct 
-{
-	Vector2 start;
-	IndexList index_list;
-} Grid;
-typedef Grid Cell;
+// called with each circle binned in a queried cell
+typedef void (*CircleVisitor)(void* context, int circle);
 
-void create_grid(Grid grid[ROW][COL], Vector2 border_center);
-void add_circle_to_grid(Grid grid[ROW][COL], int c_index, Vector2 position);
-void clear_grid_index_lists(Grid grid[ROW][COL]);
-void grid_circle_collision(Grid grid[ROW][COL], Circles* circles);
-void dealloc_grid(Grid grid[ROW][COL]);
+Grid create_grid(Vector2 start, Vector2 extent, float cell_size);
+bool grid_covers(Grid* grid, Vector2 start, Vector2 extent);
+void build_grid(Grid* grid, Circles* circles);
+void grid_stencil_runs(Grid* grid, int cell, int* right_end, int* below_begin, int* below_end);
+void grid_query(Grid* grid, Vector2 low, Vector2 high, CircleVisitor visit, void* context);
+int grid_group_size(Grid* grid, int group);
+void grid_collide_group(Grid* grid, Circles* circles, int group, int begin, int end);
+void dealloc_grid(Grid* grid);
 
-#endif
\ No newline at end of file
+#endif
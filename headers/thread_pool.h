@@ -0,0 +1,91 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// runs [begin, end) of some range of work
+typedef void (*RangeFunction)(void* context, int begin, int end);
+
+// the size of a task's range, asked for once its dependencies are done so it may depend on their results
+typedef int (*RangeCount)(void* context);
+
+// a range of work in a task graph, split into jobs once every task it depends on is done
+typedef struct
+{
+	RangeFunction function;
+	RangeCount count;       // NULL for the fixed range [begin, end)
+	void* context;
+	int begin;
+	int end;
+	bool serial;            // run the whole range as one job
+
+	int dependencies;
+	atomic_int unmet;       // dependencies not yet done in this run
+	atomic_int pending;     // jobs of this task still running
+	int* dependents;        // kept allocated across clears of the graph
+	int dependent_count;
+	int dependent_capacity;
+} Task;
+
+typedef struct
+{
+	int task;
+	int begin;
+	int end;
+} Job;
+
+// tasks are added in an order where every dependency comes first, which is also the order a lone thread runs them in
+typedef struct
+{
+	Task* tasks;
+	int task_count;
+	int task_capacity;
+
+	Job* jobs;              // every job of a run, handed out from job_cursor
+	atomic_int job_cursor;
+	int job_capacity;
+	atomic_int remaining;   // tasks not yet done in this run
+} TaskGraph;
+
+// chase-lev deque, the owning worker pushes and pops the bottom and the others steal from the top
+typedef struct
+{
+	_Atomic(Job*)* buffer;
+	long capacity;          // a power of two
+	atomic_long top;
+	atomic_long bottom;
+} JobDeque;
+
+typedef struct
+{
+	int thread_count;       // including the thread running a graph
+	pthread_t* workers;
+	JobDeque* deques;       // one per thread, the calling thread owns the first
+
+	pthread_mutex_t lock;
+	pthread_cond_t work_ready;
+	pthread_cond_t work_done;
+	int generation;
+	int active;
+	bool shutdown;
+	atomic_int started;     // hands each worker its deque
+
+	TaskGraph* graph;       // graph being run
+	TaskGraph range_graph;  // the single task parallel_for runs
+} ThreadPool;
+
+ThreadPool* create_thread_pool(int thread_count);
+void parallel_for(ThreadPool* pool, int begin, int end, RangeFunction function, void* context);
+void dealloc_thread_pool(ThreadPool* pool);
+
+TaskGraph create_task_graph();
+void clear_task_graph(TaskGraph* graph);
+int add_task(TaskGraph* graph, RangeFunction function, void* context, int begin, int end);
+int add_counted_task(TaskGraph* graph, RangeFunction function, RangeCount count, void* context);
+void add_dependency(TaskGraph* graph, int before, int after);
+void run_task_graph(ThreadPool* pool, TaskGraph* graph);
+void dealloc_task_graph(TaskGraph* graph);
+
+#endif
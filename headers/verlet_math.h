@@ -0,0 +1,25 @@
+#ifndef VERLET_MATH_H
+#define VERLET_MATH_H
+
+// the simulation core only needs raylib's plain data types and raymath, so it can be built and
+// linked without raylib. when used alongside raylib, include raylib.h before any core header
+
+#include <stdbool.h>
+
+#ifndef RAYMATH_H
+	#define RAYMATH_STATIC_INLINE
+#endif
+#include "raymath.h"
+
+#if !defined(RL_COLOR_TYPE)
+typedef struct Color
+{
+	unsigned char r;
+	unsigned char g;
+	unsigned char b;
+	unsigned char a;
+} Color;
+#define RL_COLOR_TYPE
+#endif
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "verlet_math.h"
+#include "circle.h"
+#include "link.h"
+#include "spatial_partition.h"
+#include "spatial_hash.h"
+#include "neighbor_list.h"
+#include "reorder.h"
+#include "perf_counters.h"
+#include "thread_pool.h"
+
+// user input handed to the simulation as plain data, so the core never polls a window
+typedef struct
+{
+	Vector2 cursor;
+	bool cut;       // tear links passing under the cursor
+	CircleHandle grabbed;   // circle pinned to the cursor, NO_CIRCLE for none
+} VerletInput;
+
+typedef enum
+{
+	DENSE_GRID = 0,     // flat grid over the world bounds, best for a bounded, densely filled world
+	HASHED_GRID = 1,    // hashed occupied cells only, for large or open worlds
+	NEIGHBOR_LIST = 2,  // dense grid pairs kept across substeps, for settled piles that barely move
+} Broadphase;
+
+// the parts of a step, timed on every thread that runs them
+typedef enum
+{
+	PHASE_SETUP = 0,    // grid fitting, reordering and link coloring before the step graph, compaction after it
+	PHASE_INTEGRATE,    // integration and the border
+	PHASE_BROADPHASE,
+	PHASE_COLLIDE,
+	PHASE_LINKS,
+	PHASE_COUNT,
+} StepPhase;
+
+// running totals since the last reset_world_stats. phase times add up the time of every thread, so with more than
+// one worker they can exceed step_ns, and so do the counters
+typedef struct
+{
+	atomic_llong phase_ns[PHASE_COUNT];
+	atomic_llong counters[PHASE_COUNT][COUNTER_COUNT];
+	atomic_int counted;         // mask of the counter kinds some thread could read
+	long long step_ns;          // wall time inside world_step
+	long long circle_substeps;  // circles times substeps, for the cost of one circle for one substep
+	unsigned int steps;
+} WorldStats;
+
+typedef struct
+{
+	Circles circles;
+	Chain chain;
+	Broadphase broadphase;
+	Grid* grid;             // allocated on the first colliding step
+	SpatialHash* hash;
+	NeighborList* neighbors;
+	float neighbor_skin;    // margin the neighbor list gathers pairs out to, it is rebuilt once a circle moves half of it
+
+	bool collide;           // circle to circle collision through the spatial grid
+	int reorder_interval;   // steps between sorting the circles into z-order, 0 never sorts
+	int steps_since_reorder;
+	unsigned int steps;     // world steps run so far
+	WorldStats stats;
+	bool counting;          // read hardware counters around every phase, a syscall at each end of every job
+	int substep;            // substep being run, and when it started, for traces
+	long long substep_start;
+	int worker_count;       // threads running the step, 1 runs it on the calling thread
+	ThreadPool* pool;
+	TaskGraph step_graph;   // the tasks of one step, rebuilt every step
+	bool sleeping;          // resting circles sleep and skip integration and collision until something wakes them
+	bool slept;             // sleeping and gravity as of the last step, a change wakes every circle
+	Vector2 slept_gravity;
+	bool bounded;           // keep circles inside the circular border
+	Vector2 border_center;
+	float border_radius;
+
+	Vector2 gravity;
+	float damping;
+	int link_iterations;    // link solves per substep, more iterations means stiffer links
+	float max_link_distance;
+	float cut_radius;
+
+	VerletInput input;
+
+	// fixed timestep, world_advance runs whole steps of fixed_dt and blends the drawn positions between them
+	float fixed_dt;
+	int max_frame_steps;    // steps one frame may run before the rest of its time is dropped
+	float accumulator;
+	float alpha;            // fraction of a step the frame time is past the last step
+	float* step_start_x;
+	float* step_start_y;
+	int step_start_size;
+	unsigned int step_start_layout;
+	float* draw_x;          // interpolated positions, one per circle, valid after world_advance
+	float* draw_y;
+	int draw_capacity;
+} VerletWorld;
+
+VerletWorld create_world();
+void world_step(VerletWorld* world, float dt, int substeps);
+int world_advance(VerletWorld* world, float frame_dt, int substeps);
+void world_interpolate(VerletWorld* world);
+void world_set_input(VerletWorld* world, VerletInput input);
+CircleHandle world_pick(VerletWorld* world, Vector2 point);
+int world_erase(VerletWorld* world, Vector2 center, float radius);
+void reset_world_stats(VerletWorld* world);
+const char* step_phase_name(StepPhase phase);
+void dealloc_world(VerletWorld* world);
+
+#endif
@@ -0,0 +1,133 @@
+#include "headers/histogram.h"
+#include <string.h>
+
+static int bucket_of(long long value)
+{
+	if(value < HISTOGRAM_SUB_BUCKETS)
+		return (value < 0) ? 0 : value;
+
+	int top = 63 - __builtin_clzll(value);
+
+	if(top >= HISTOGRAM_MAX_BITS)
+		return HISTOGRAM_BUCKETS - 1;
+
+	// the SUB_BITS bits below the top bit pick the sub bucket
+	int shift = top - HISTOGRAM_SUB_BITS;
+
+	return (HISTOGRAM_SUB_BUCKETS * shift) + (value >> shift);
+}
+
+// largest value a bucket holds
+static long long bucket_high(int bucket)
+{
+	if(bucket < HISTOGRAM_SUB_BUCKETS)
+		return bucket;
+
+	int shift = (bucket / HISTOGRAM_SUB_BUCKETS) - 1;
+	long long sub = bucket - (HISTOGRAM_SUB_BUCKETS * shift);
+
+	return ((sub + 1) << shift) - 1;
+}
+
+static long long bucket_low(int bucket)
+{
+	return (bucket == 0) ? 0 : (bucket_high(bucket - 1) + 1);
+}
+
+void clear_histogram(Histogram* histogram)
+{
+	memset(histogram, 0, sizeof(Histogram));
+}
+
+void record_histogram(Histogram* histogram, long long value)
+{
+	histogram->counts[bucket_of(value)]++;
+	histogram->count++;
+
+	if(value > histogram->max)
+		histogram->max = value;
+}
+
+void merge_histogram(Histogram* into, const Histogram* from)
+{
+	for(int b = 0; b < HISTOGRAM_BUCKETS; b++)
+		into->counts[b] += from->counts[b];
+
+	into->count += from->count;
+
+	if(from->max > into->max)
+		into->max = from->max;
+}
+
+// the top of the bucket the percentile falls in, so the tail is never understated. 100 gives the exact max
+long long histogram_percentile(const Histogram* histogram, double percentile)
+{
+	if(histogram->count == 0)
+		return 0;
+
+	long long rank = (long long)((percentile / 100.0) * histogram->count + 0.5);
+	long long seen = 0;
+
+	if(rank < 1)
+		rank = 1;
+
+	for(int b = 0; b < HISTOGRAM_BUCKETS; b++)
+	{
+		seen += histogram->counts[b];
+
+		if((seen >= rank) && (b < HISTOGRAM_BUCKETS - 1))
+			return (bucket_high(b) < histogram->max) ? bucket_high(b) : histogram->max;
+	}
+
+	return histogram->max;
+}
+
+// one row per non empty bucket, bounds in milliseconds and the fraction of values at or below the bucket
+bool write_histogram_csv(FILE* file, const char* series, const Histogram* histogram)
+{
+	long long seen = 0;
+
+	for(int b = 0; b < HISTOGRAM_BUCKETS; b++)
+	{
+		if(histogram->counts[b] == 0)
+			continue;
+
+		seen += histogram->counts[b];
+
+		if(fprintf(file, "%s,%.6f,%.6f,%u,%.6f\n", series, bucket_low(b) / 1e6, bucket_high(b) / 1e6, histogram->counts[b], (double)seen / histogram->count) < 0)
+			return false;
+	}
+
+	return true;
+}
+
+RollingHistogram create_rolling_histogram(float window_seconds, long long now)
+{
+	RollingHistogram rolling;
+
+	clear_histogram(&rolling.current);
+	clear_histogram(&rolling.previous);
+	rolling.window_ns = window_seconds * 1e9;
+	rolling.window_start = now;
+
+	return rolling;
+}
+
+void record_rolling_histogram(RollingHistogram* rolling, long long value, long long now)
+{
+	if(now - rolling->window_start >= rolling->window_ns)
+	{
+		rolling->previous = rolling->current;
+		clear_histogram(&rolling->current);
+		rolling->window_start = now;
+	}
+
+	record_histogram(&rolling->current, value);
+}
+
+// the values of both windows together
+void rolling_histogram_view(const RollingHistogram* rolling, Histogram* view)
+{
+	*view = rolling->previous;
+	merge_histogram(view, &rolling->current);
+}
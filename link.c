@@ -1,41 +1,170 @@
 #include <stdlib.h>
+#include <stdint.h>
 #include "headers/link.h"
 
+static void realloc_link_arrays(Chain* chain)
+{
+	size_t n = chain->capacity;
+
+	chain->circle1 = realloc(chain->circle1, n * sizeof(int));
+	chain->circle2 = realloc(chain->circle2, n * sizeof(int));
+	chain->target_distance = realloc(chain->target_distance, n * sizeof(float));
+	chain->alive = realloc(chain->alive, n * sizeof(unsigned char));
+	chain->handle1 = realloc(chain->handle1, n * sizeof(CircleHandle));
+	chain->handle2 = realloc(chain->handle2, n * sizeof(CircleHandle));
+}
+
 Chain create_chain()
 {
-	Chain chain;
+	Chain chain = { 0 };
 
 	chain.size  = 0;
-	chain.capacity = sizeof(Link);
-	chain.link = malloc(chain.capacity);
+	chain.alive_count = 0;
+	chain.capacity = 1;
+	chain.layout = 0;
+	chain.compactions = 0;
+	realloc_link_arrays(&chain);
 
-	return chain;
-}
+	chain.color_count = 0;
+	chain.color_start = calloc((LINK_COLORS + 1), sizeof(int));
+	chain.colored = NULL;
+	chain.colored_size = -1;
+	chain.colored_compactions = 0;
 
-void draw_links(Chain* chain)
-{
-	for(int i = 0; i < chain->size; i++)
-		DrawLine(chain->link[i].circle1->current_position.x, chain->link[i].circle1->current_position.y, chain->link[i].circle2->current_position.x, chain->link[i].circle2->current_position.y, LIGHTGRAY);
+	return chain;
 }
 
 void resize_chain(Chain* chain)
 {
 	chain->capacity *= 2;
-	chain->link = realloc(chain->link, chain->capacity);
+	realloc_link_arrays(chain);
 }
 
-void add_link(Chain* chain, Link link)
+void add_link(Chain* chain, Circles* circles, Link link)
 {
-	if((chain->size * sizeof(Link)) == chain->capacity)
+	if(chain->size == chain->capacity)
 		resize_chain(chain);
 
-	chain->link[chain->size++] = link;
+	int l = chain->size++;
+
+	chain->handle1[l] = link.circle1;
+	chain->handle2[l] = link.circle2;
+	chain->circle1[l] = circle_index(circles, link.circle1);
+	chain->circle2[l] = circle_index(circles, link.circle2);
+	chain->target_distance[l] = link.target_distance;
+	chain->alive[l] = (chain->circle1[l] != -1) && (chain->circle2[l] != -1);
+	chain->alive_count += chain->alive[l];
 }
 
+// links are only marked dead, so deleting never shifts the arrays
 void delete_link(Chain* chain, int position)
 {
-	for(int i = position; i < chain->size; i++)
-		chain->link[i] = chain->link[i + 1];
+	if(chain->alive[position])
+	{
+		chain->alive[position] = 0;
+		chain->alive_count--;
+	}
+}
+
+// resolves the indicies again if circles moved since the last sync, a link dies with either of its circles
+void sync_chain(Chain* chain, Circles* circles)
+{
+	if(chain->layout == circles->layout)
+		return;
+
+	for(int l = 0; l < chain->size; l++)
+	{
+		if(!chain->alive[l])
+			continue;
+
+		chain->circle1[l] = circle_index(circles, chain->handle1[l]);
+		chain->circle2[l] = circle_index(circles, chain->handle2[l]);
+
+		if((chain->circle1[l] == -1) || (chain->circle2[l] == -1))
+			delete_link(chain, l);
+	}
+
+	chain->layout = circles->layout;
+}
+
+// drops dead links, keeping the order of the live ones
+void compact_chain(Chain* chain)
+{
+	int size = 0;
 
-	chain->size--;
-}
\ No newline at end of file
+	for(int l = 0; l < chain->size; l++)
+	{
+		if(!chain->alive[l])
+			continue;
+
+		chain->circle1[size] = chain->circle1[l];
+		chain->circle2[size] = chain->circle2[l];
+		chain->target_distance[size] = chain->target_distance[l];
+		chain->alive[size] = 1;
+		chain->handle1[size] = chain->handle1[l];
+		chain->handle2[size] = chain->handle2[l];
+		size++;
+	}
+
+	chain->size = size;
+	chain->compactions++;
+}
+
+// greedy edge coloring, each link takes the lowest color neither of its circles has used yet
+void color_chain(Chain* chain, int circle_count)
+{
+	uint64_t* used = calloc(circle_count, sizeof(uint64_t));
+	unsigned char* color = malloc(chain->size > 0 ? chain->size : 1);
+	int count[LINK_COLORS + 1] = { 0 };
+
+	chain->colored = realloc(chain->colored, sizeof(int) * (chain->size > 0 ? chain->size : 1));
+	chain->color_count = 0;
+
+	for(int l = 0; l < chain->size; l++)
+	{
+		if(!chain->alive[l])
+			continue;
+
+		int a = chain->circle1[l], b = chain->circle2[l];
+		uint64_t free_colors = ~(used[a] | used[b]) & ~(1ull << (LINK_COLORS - 1));
+		int c = free_colors ? __builtin_ctzll(free_colors) : (LINK_COLORS - 1);
+
+		if(c < (LINK_COLORS - 1))
+		{
+			used[a] |= (1ull << c);
+			used[b] |= (1ull << c);
+		}
+
+		color[l] = c;
+		count[c + 1]++;
+		chain->color_count = (c >= chain->color_count) ? (c + 1) : chain->color_count;
+	}
+
+	for(int c = 0; c < LINK_COLORS; c++)
+		count[c + 1] += count[c];
+
+	for(int c = 0; c <= LINK_COLORS; c++)
+		chain->color_start[c] = count[c];
+
+	for(int l = 0; l < chain->size; l++)
+		if(chain->alive[l])
+			chain->colored[count[color[l]]++] = l;
+
+	chain->colored_size = chain->size;
+	chain->colored_compactions = chain->compactions;
+
+	free(used);
+	free(color);
+}
+
+void dealloc_chain(Chain* chain)
+{
+	free(chain->circle1);
+	free(chain->circle2);
+	free(chain->target_distance);
+	free(chain->alive);
+	free(chain->handle1);
+	free(chain->handle2);
+	free(chain->color_start);
+	free(chain->colored);
+}
@@ -0,0 +1,182 @@
+#include "headers/neighbor_list.h"
+#include "headers/profile.h"
+#include <string.h>
+
+NeighborList create_neighbor_list(float skin)
+{
+	NeighborList list = { 0 };
+
+	list.skin = skin;
+	list.group_start = calloc((CELL_GROUPS + 1), sizeof(int));
+	list.circle_count = -1;
+
+	return list;
+}
+
+// rebuilt when circles were added, removed or moved to other indicies, the skin changed, or any circle is
+// more than half the skin from where it was at the build
+bool neighbor_list_stale(NeighborList* list, Circles* circles)
+{
+	if((list->circle_count != circles->size) || (list->layout != circles->layout) || (list->built_skin != list->skin))
+		return true;
+
+	float limit = (list->skin * 0.5f) * (list->skin * 0.5f);
+
+	for(int i = 0; i < circles->size; i++)
+	{
+		float dx = circles->x[i] - list->anchor_x[i], dy = circles->y[i] - list->anchor_y[i];
+
+		if(((dx * dx) + (dy * dy)) > limit)
+			return true;
+	}
+
+	return false;
+}
+
+static void push_candidate(NeighborList* list, int j)
+{
+	if(list->candidate_count == list->candidate_capacity)
+	{
+		list->candidate_capacity = (list->candidate_capacity > 0) ? (list->candidate_capacity * 2) : 1024;
+		list->candidates = realloc(list->candidates, sizeof(int) * list->candidate_capacity);
+	}
+
+	list->candidates[list->candidate_count++] = j;
+}
+
+static void push_row(NeighborList* list, int i)
+{
+	// one extra slot for the closing offset
+	if((list->row_count + 1) >= list->row_capacity)
+	{
+		list->row_capacity = (list->row_capacity > 0) ? (list->row_capacity * 2) : 256;
+		list->row_circle = realloc(list->row_circle, sizeof(int) * list->row_capacity);
+		list->candidate_start = realloc(list->candidate_start, sizeof(int) * list->row_capacity);
+	}
+
+	list->row_circle[list->row_count] = i;
+	list->candidate_start[list->row_count++] = list->candidate_count;
+}
+
+// keeps the candidates from begin to end within contact distance plus the skin of circle i
+static void gather(NeighborList* list, Grid* grid, Circles* circles, int i, int begin, int end)
+{
+	for(int k = begin; k < end; k++)
+	{
+		int j = grid->indicies[k];
+		float reach = circles->radius[i] + circles->radius[j] + list->skin;
+		float dx = circles->x[i] - circles->x[j], dy = circles->y[i] - circles->y[j];
+
+		if(((dx * dx) + (dy * dy)) < (reach * reach))
+			push_candidate(list, j);
+	}
+}
+
+// the grid has to be built from the current positions, with cells at least one diameter plus the skin wide
+void build_neighbor_list(NeighborList* list, Grid* grid, Circles* circles)
+{
+	PROFILE_SCOPE(PROFILE_NEIGHBORS);
+
+	if((size_t)(grid->occupied_count + 1) > list->owner_capacity)
+	{
+		list->owner_capacity = grid->occupied_count + 1;
+		list->row_start = realloc(list->row_start, sizeof(int) * list->owner_capacity);
+	}
+
+	memcpy(list->group_start, grid->group_start, sizeof(int) * (CELL_GROUPS + 1));
+	list->owner_count = grid->occupied_count;
+	list->row_count = 0;
+	list->candidate_count = 0;
+
+	// the same half stencil as the grid, the rest of the cell, the cell to the right and the three below
+	for(int o = 0; o < grid->occupied_count; o++)
+	{
+		int cell = grid->group_cells[o];
+		int begin = grid->cell_start[cell];
+		int end = begin + grid->cell_count[cell];
+		int right_end, below_begin, below_end;
+
+		list->row_start[o] = list->row_count;
+		grid_stencil_runs(grid, cell, &right_end, &below_begin, &below_end);
+
+		for(int k = begin; k < end; k++)
+		{
+			int i = grid->indicies[k];
+
+			push_row(list, i);
+			gather(list, grid, circles, i, (k + 1), right_end);
+			gather(list, grid, circles, i, below_begin, below_end);
+
+			// a circle with nothing in reach keeps no row
+			if(list->candidate_count == list->candidate_start[list->row_count - 1])
+				list->row_count--;
+		}
+	}
+
+	list->row_start[list->owner_count] = list->row_count;
+
+	if(list->row_count > 0)
+		list->candidate_start[list->row_count] = list->candidate_count;
+
+	if((size_t)circles->size > list->anchor_capacity)
+	{
+		list->anchor_capacity = circles->capacity;
+		list->anchor_x = realloc(list->anchor_x, sizeof(float) * list->anchor_capacity);
+		list->anchor_y = realloc(list->anchor_y, sizeof(float) * list->anchor_capacity);
+	}
+
+	if(circles->size > 0)
+	{
+		memcpy(list->anchor_x, circles->x, sizeof(float) * circles->size);
+		memcpy(list->anchor_y, circles->y, sizeof(float) * circles->size);
+	}
+
+	list->circle_count = circles->size;
+	list->layout = circles->layout;
+	list->built_skin = list->skin;
+	list->builds++;
+}
+
+int neighbor_group_size(NeighborList* list, int group)
+{
+	return list->group_start[group + 1] - list->group_start[group];
+}
+
+// owner cells [begin, end) of one group
+void neighbor_collide_group(NeighborList* list, Circles* circles, int group, int begin, int end)
+{
+	int first = list->group_start[group];
+
+	for(int o = (first + begin); o < (first + end); o++)
+		for(int row = list->row_start[o]; row < list->row_start[o + 1]; row++)
+		{
+			int i = list->row_circle[row];
+			int* candidates = list->candidates + list->candidate_start[row];
+			int count = list->candidate_start[row + 1] - list->candidate_start[row];
+
+			// a row where nothing can move is skipped, which is every row of a cell that has gone to sleep
+			if(circles->status[i] != FREE)
+			{
+				int k = 0;
+
+				while((k < count) && (circles->status[candidates[k]] != FREE))
+					k++;
+
+				if(k == count)
+					continue;
+			}
+
+			handle_verlet_circle_batch(circles, i, candidates, count);
+		}
+}
+
+void dealloc_neighbor_list(NeighborList* list)
+{
+	free(list->group_start);
+	free(list->row_start);
+	free(list->row_circle);
+	free(list->candidate_start);
+	free(list->candidates);
+	free(list->anchor_x);
+	free(list->anchor_y);
+}
@@ -0,0 +1,138 @@
+#include "headers/perf_counters.h"
+#include <string.h>
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// -2 until the thread first asks, -1 once opening failed
+static _Thread_local int leader = -2;
+static _Thread_local int members[COUNTER_COUNT];    // kind of each group member, in the order read returns them
+static _Thread_local int member_fds[COUNTER_COUNT];
+static _Thread_local int member_count = 0;
+static _Thread_local int error = 0;
+
+static const unsigned long long CONFIGS[COUNTER_COUNT][2] =
+{
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+// opens every counter the machine has as one group, so they are scheduled onto the pmu together. returns a mask of the kinds opened
+int open_counters()
+{
+	int mask = 0;
+
+	if(leader != -2)
+	{
+		for(int m = 0; m < member_count; m++)
+			mask |= 1 << members[m];
+
+		return mask;
+	}
+
+	leader = -1;
+
+	for(int k = 0; k < COUNTER_COUNT; k++)
+	{
+		struct perf_event_attr attr;
+
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = CONFIGS[k][0];
+		attr.config = CONFIGS[k][1];
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		int fd = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+
+		if(fd == -1)
+		{
+			error = errno;
+			continue;
+		}
+
+		if(leader == -1)
+			leader = fd;
+
+		member_fds[member_count] = fd;
+		members[member_count++] = k;
+		mask |= 1 << k;
+	}
+
+	return mask;
+}
+
+// counts since the group was opened, scaled up when the kernel had to share the pmu with other groups
+bool read_counters(CounterSample* sample)
+{
+	unsigned long long buffer[3 + COUNTER_COUNT];
+
+	for(int k = 0; k < COUNTER_COUNT; k++)
+		sample->values[k] = -1;
+
+	if((open_counters() == 0) || (read(leader, buffer, sizeof(buffer)) < (ssize_t)(sizeof(unsigned long long) * (3 + member_count))))
+		return false;
+
+	double scale = ((buffer[2] > 0) && (buffer[2] < buffer[1])) ? ((double)buffer[1] / buffer[2]) : 1;
+
+	for(int m = 0; m < member_count; m++)
+		sample->values[members[m]] = buffer[3 + m] * scale;
+
+	return true;
+}
+
+// closes the calling thread's group, called by threads about to exit. a later open_counters opens it again
+void close_counters()
+{
+	for(int m = 0; m < member_count; m++)
+		close(member_fds[m]);
+
+	leader = -2;
+	member_count = 0;
+}
+
+const char* counters_error()
+{
+	return (error != 0) ? strerror(error) : "none";
+}
+
+#else
+
+int open_counters()
+{
+	return 0;
+}
+
+bool read_counters(CounterSample* sample)
+{
+	for(int k = 0; k < COUNTER_COUNT; k++)
+		sample->values[k] = -1;
+
+	return false;
+}
+
+void close_counters()
+{
+}
+
+const char* counters_error()
+{
+	return "perf_event_open is linux only";
+}
+
+#endif
+
+const char* counter_name(CounterKind kind)
+{
+	static const char* names[COUNTER_COUNT] = { "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses" };
+
+	return ((kind >= 0) && (kind < COUNTER_COUNT)) ? names[kind] : "unknown";
+}
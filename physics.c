@@ -1,70 +1,292 @@
 #include "headers/physics.h"
-#include "headers/raylib.h"
-#include "headers/raymath.h"
 #include <stdlib.h>
 
-void handle_border_collision(VerletCirlce* circle, Vector2 constraint_center, Vector2 world_gravity, float constraint_radius)
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+static const float COLLISION_SCALE = 0.45f;
+
+// a circle moving less than SLEEP_SPEED a substep for SLEEP_SUBSTEPS substeps in a row falls asleep, and only
+// wakes when an awake circle moving faster than WAKE_SPEED runs into it or falls away from under it
+static const float SLEEP_SPEED = 0.05f;
+static const float WAKE_SPEED = 0.15f;
+static const int SLEEP_SUBSTEPS = 60;
+
+bool circle_moving(Circles* circles, int i)
+{
+	float dx = circles->x[i] - circles->previous_x[i], dy = circles->y[i] - circles->previous_y[i];
+	return ((dx * dx) + (dy * dy)) > (WAKE_SPEED * WAKE_SPEED);
+}
+
+static void wake_on_contact(Circles* circles, int i, int j)
+{
+	if((circles->status[j] == SLEEPING) && (circles->status[i] == FREE) && circle_moving(circles, i))
+		wake_circle(circles, j);
+	else if((circles->status[i] == SLEEPING) && (circles->status[j] == FREE) && circle_moving(circles, j))
+		wake_circle(circles, i);
+}
+
+// a circle whose support falls away is never run into, so a moving circle just below a sleeper wakes it too. below is
+// along gravity, and just below is within a sleeper's radius of touching, which a falling support is for its first substeps
+void wake_on_support_loss(Circles* circles, int sleeper, int mover, Vector2 gravity)
+{
+	if((circles->status[sleeper] != SLEEPING) || (circles->status[mover] != FREE))
+		return;
+
+	float dx = circles->x[mover] - circles->x[sleeper], dy = circles->y[mover] - circles->y[sleeper];
+	float reach = (2 * circles->radius[sleeper]) + circles->radius[mover];
+
+	if((((dx * gravity.x) + (dy * gravity.y)) > 0) && (((dx * dx) + (dy * dy)) <= (reach * reach)))
+		wake_circle(circles, sleeper);
+}
+
+void wake_circle(Circles* circles, int i)
+{
+	circles->status[i] = FREE;
+	circles->rest[i] = 0;
+}
+
+// called after integrating a free circle. a sleeping circle keeps no velocity, so it wakes from a standstill
+void update_rest(Circles* circles, int i)
+{
+	float dx = circles->x[i] - circles->previous_x[i], dy = circles->y[i] - circles->previous_y[i];
+
+	if(((dx * dx) + (dy * dy)) >= (SLEEP_SPEED * SLEEP_SPEED))
+	{
+		circles->rest[i] = 0;
+		return;
+	}
+
+	if(++circles->rest[i] >= SLEEP_SUBSTEPS)
+	{
+		circles->status[i] = SLEEPING;
+		circles->previous_x[i] = circles->x[i];
+		circles->previous_y[i] = circles->y[i];
+	}
+}
+
+// a sleeping circle pushed past the border, by the border shrinking, is woken to be pushed back in
+bool outside_border(Circles* circles, int i, Vector2 constraint_center, float constraint_radius)
 {
-	if((Vector2Distance(circle->current_position, constraint_center) + circle->radius) >= constraint_radius)
+	Vector2 position = { circles->x[i], circles->y[i] };
+	return (Vector2Distance(position, constraint_center) + circles->radius[i]) > (constraint_radius + SLEEP_SPEED);
+}
+
+void handle_border_collision(Circles* circles, int i, Vector2 constraint_center, Vector2 world_gravity, float constraint_radius)
+{
+	Vector2 position = { circles->x[i], circles->y[i] };
+
+	if((Vector2Distance(position, constraint_center) + circles->radius[i]) >= constraint_radius)
 	{
-		Vector2 direction = Vector2Normalize(Vector2Subtract(circle->current_position, constraint_center));
+		Vector2 direction = Vector2Normalize(Vector2Subtract(position, constraint_center));
 		
-		circle->current_position = Vector2Add(constraint_center, Vector2Scale(direction, (constraint_radius - circle->radius)));
-		circle->acceleration = world_gravity;
+		position = Vector2Add(constraint_center, Vector2Scale(direction, (constraint_radius - circles->radius[i])));
+		circles->x[i] = position.x;
+		circles->y[i] = position.y;
+		circles->acceleration_x[i] = world_gravity.x;
+		circles->acceleration_y[i] = world_gravity.y;
 	}
 }
 
-void handle_verlet_circle_collision(VerletCirlce* circle1, VerletCirlce* circle2)
+void handle_verlet_circle_collision(Circles* circles, int i, int j)
 {
-	const float SCALE = 0.45f;
-	float distance = Vector2Distance(circle1->current_position, circle2->current_position);
+	Vector2 position1 = { circles->x[i], circles->y[i] };
+	Vector2 position2 = { circles->x[j], circles->y[j] };
 	
-	if(CheckCollisionCircles(circle1->current_position, circle1->radius, circle2->current_position, circle2->radius))
+	// most pairs miss, so reject on the squared distance before paying for the sqrt
+	if(circles_overlap(position1, circles->radius[i], position2, circles->radius[j]))
 	{
-		float delta = (circle1->radius + circle2->radius) - distance;
-		Vector2 direction = Vector2Normalize(Vector2Subtract(circle1->current_position, circle2->current_position));
+		wake_on_contact(circles, i, j);
+
+		float delta = (circles->radius[i] + circles->radius[j]) - Vector2Distance(position1, position2);
+		Vector2 correction = Vector2Scale(Vector2Normalize(Vector2Subtract(position1, position2)), (delta * COLLISION_SCALE));
+
+		if(circles->status[i] == FREE)
+		{
+			circles->x[i] += correction.x;
+			circles->y[i] += correction.y;
+		}
+
+		if(circles->status[j] == FREE)
+		{
+			circles->x[j] -= correction.x;
+			circles->y[j] -= correction.y;
+		}
+	}
+}
+
+// applies the per lane corrections a kernel produced, candidates move away from circle i and circle i takes the sum
+static void apply_lane_corrections(Circles* circles, int i, const int* candidates, const float* correction_x, const float* correction_y, int mask, int lanes)
+{
+	float sum_x = 0, sum_y = 0;
+
+	for(int k = 0; k < lanes; k++)
+	{
+		if(!(mask & (1 << k)))
+			continue;
+
+		int j = candidates[k];
 
-		if(circle1->status == FREE)
-			circle1->current_position = Vector2Add(circle1->current_position, Vector2Scale(direction, (delta * SCALE)));
+		wake_on_contact(circles, i, j);
 
-		if(circle2->status == FREE)
-			circle2->current_position = Vector2Subtract(circle2->current_position, Vector2Scale(direction, (delta * SCALE)));
+		if(circles->status[j] == FREE)
+		{
+			circles->x[j] -= correction_x[k];
+			circles->y[j] -= correction_y[k];
+		}
+
+		sum_x += correction_x[k];
+		sum_y += correction_y[k];
 	}
+
+	if(circles->status[i] == FREE)
+	{
+		circles->x[i] += sum_x;
+		circles->y[i] += sum_y;
+	}
+}
+
+#if defined(__AVX2__)
+
+#define COLLISION_LANES 8
+
+// tests circle i against 8 candidates at once, lanes that miss (or sit exactly on circle i) get a zero correction
+static void collide_lanes(Circles* circles, int i, const int* candidates)
+{
+	__m256i index = _mm256_loadu_si256((const __m256i*)candidates);
+	__m256 dx = _mm256_sub_ps(_mm256_set1_ps(circles->x[i]), _mm256_i32gather_ps(circles->x, index, 4));
+	__m256 dy = _mm256_sub_ps(_mm256_set1_ps(circles->y[i]), _mm256_i32gather_ps(circles->y, index, 4));
+	__m256 radii = _mm256_add_ps(_mm256_set1_ps(circles->radius[i]), _mm256_i32gather_ps(circles->radius, index, 4));
+	__m256 distance_sqr = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+	__m256 hit = _mm256_and_ps(_mm256_cmp_ps(distance_sqr, _mm256_mul_ps(radii, radii), _CMP_LE_OQ), _mm256_cmp_ps(distance_sqr, _mm256_setzero_ps(), _CMP_GT_OQ));
+	int mask = _mm256_movemask_ps(hit);
+
+	if(mask == 0)
+		return;
+
+	__m256 distance = _mm256_sqrt_ps(distance_sqr);
+	__m256 factor = _mm256_div_ps(_mm256_mul_ps(_mm256_sub_ps(radii, distance), _mm256_set1_ps(COLLISION_SCALE)), distance);
+	factor = _mm256_and_ps(factor, hit);
+
+	float correction_x[COLLISION_LANES], correction_y[COLLISION_LANES];
+	_mm256_storeu_ps(correction_x, _mm256_mul_ps(dx, factor));
+	_mm256_storeu_ps(correction_y, _mm256_mul_ps(dy, factor));
+
+	apply_lane_corrections(circles, i, candidates, correction_x, correction_y, mask, COLLISION_LANES);
+}
+
+#elif defined(__SSE2__)
+
+#define COLLISION_LANES 4
+
+// tests circle i against 4 candidates at once, lanes that miss (or sit exactly on circle i) get a zero correction
+static void collide_lanes(Circles* circles, int i, const int* candidates)
+{
+	__m128 dx = _mm_sub_ps(_mm_set1_ps(circles->x[i]), _mm_setr_ps(circles->x[candidates[0]], circles->x[candidates[1]], circles->x[candidates[2]], circles->x[candidates[3]]));
+	__m128 dy = _mm_sub_ps(_mm_set1_ps(circles->y[i]), _mm_setr_ps(circles->y[candidates[0]], circles->y[candidates[1]], circles->y[candidates[2]], circles->y[candidates[3]]));
+	__m128 radii = _mm_add_ps(_mm_set1_ps(circles->radius[i]), _mm_setr_ps(circles->radius[candidates[0]], circles->radius[candidates[1]], circles->radius[candidates[2]], circles->radius[candidates[3]]));
+	__m128 distance_sqr = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+	__m128 hit = _mm_and_ps(_mm_cmple_ps(distance_sqr, _mm_mul_ps(radii, radii)), _mm_cmpgt_ps(distance_sqr, _mm_setzero_ps()));
+	int mask = _mm_movemask_ps(hit);
+
+	if(mask == 0)
+		return;
+
+	__m128 distance = _mm_sqrt_ps(distance_sqr);
+	__m128 factor = _mm_div_ps(_mm_mul_ps(_mm_sub_ps(radii, distance), _mm_set1_ps(COLLISION_SCALE)), distance);
+	factor = _mm_and_ps(factor, hit);
+
+	float correction_x[COLLISION_LANES], correction_y[COLLISION_LANES];
+	_mm_storeu_ps(correction_x, _mm_mul_ps(dx, factor));
+	_mm_storeu_ps(correction_y, _mm_mul_ps(dy, factor));
+
+	apply_lane_corrections(circles, i, candidates, correction_x, correction_y, mask, COLLISION_LANES);
+}
+
+#else
+
+#define COLLISION_LANES 1
+
+#endif
+
+void handle_verlet_circle_batch(Circles* circles, int i, const int* candidates, int count)
+{
+	int k = 0;
+
+#if COLLISION_LANES > 1
+	for(; (k + COLLISION_LANES) <= count; k += COLLISION_LANES)
+		collide_lanes(circles, i, (candidates + k));
+#endif
+
+	for(; k < count; k++)
+		handle_verlet_circle_collision(circles, i, candidates[k]);
 }
 
-void update_position(VerletCirlce * circle, float slow_down_scale, float dt)
+void update_position(Circles* circles, int i, float slow_down_scale, float dt)
 {
 	const int MAX_V = 25.0f;
 
-	Vector2 velocity = Vector2Scale(Vector2Subtract(circle->current_position, circle->previous_position), slow_down_scale);
+	Vector2 velocity = Vector2Scale((Vector2){ (circles->x[i] - circles->previous_x[i]), (circles->y[i] - circles->previous_y[i]) }, slow_down_scale);
 	
 	if(Vector2Length(velocity) >= MAX_V) 
 		velocity = (Vector2){};
 
-	circle->previous_position = circle->current_position;
-	circle->current_position = Vector2Add(circle->current_position, Vector2Add(velocity, Vector2Scale(circle->acceleration, powf(dt, 2.0f)))); // x(n+1) = x(n) + v + a(dt)^2, verlet integration formula
+	circles->previous_x[i] = circles->x[i];
+	circles->previous_y[i] = circles->y[i];
+
+	// x(n+1) = x(n) + v + a(dt)^2, verlet integration formula
+	circles->x[i] += velocity.x + (circles->acceleration_x[i] * powf(dt, 2.0f));
+	circles->y[i] += velocity.y + (circles->acceleration_y[i] * powf(dt, 2.0f));
 }
 
-void apply_gravity(VerletCirlce* circle, Vector2 world_gravity, float dt)
+void apply_gravity(Circles* circles, int i, Vector2 world_gravity, float dt)
 {
-	Vector2 delta = Vector2Scale(Vector2Subtract(world_gravity, circle->acceleration), dt);
-	circle->acceleration = Vector2Add(circle->acceleration, delta);
+	circles->acceleration_x[i] += (world_gravity.x - circles->acceleration_x[i]) * dt;
+	circles->acceleration_y[i] += (world_gravity.y - circles->acceleration_y[i]) * dt;
 }
 
-void maintain_link(Link* link)
+void maintain_link(Circles* circles, int i, int j, float target_distance)
 {
 	const float SCALE = 0.30;
-	float circle_distance = Vector2Distance(link->circle1->current_position, link->circle2->current_position);
+	Vector2 position1 = { circles->x[i], circles->y[i] };
+	Vector2 position2 = { circles->x[j], circles->y[j] };
+	float circle_distance = Vector2Distance(position1, position2);
 
-	if(circle_distance >= link->target_distance)
+	if(circle_distance >= target_distance)
 	{
-		float delta = link->target_distance - circle_distance;
-		Vector2 direction = Vector2Normalize(Vector2Subtract(link->circle1->current_position, link->circle2->current_position));
+		wake_on_contact(circles, i, j);
+
+		float delta = target_distance - circle_distance;
+		Vector2 correction = Vector2Scale(Vector2Normalize(Vector2Subtract(position1, position2)), (delta * SCALE));
 
-		if(link->circle1->status == FREE)
-			link->circle1->current_position = Vector2Add(link->circle1->current_position, Vector2Scale(direction, (delta * SCALE)));
+		if(circles->status[i] == FREE)
+		{
+			circles->x[i] += correction.x;
+			circles->y[i] += correction.y;
+		}
 		
-		if(link->circle2->status == FREE)
-			link->circle2->current_position = Vector2Subtract(link->circle2->current_position, Vector2Scale(direction, (delta * SCALE)));
+		if(circles->status[j] == FREE)
+		{
+			circles->x[j] -= correction.x;
+			circles->y[j] -= correction.y;
+		}
 	}
-}
\ No newline at end of file
+}
+
+bool circles_overlap(Vector2 center1, float radius1, Vector2 center2, float radius2)
+{
+	float radii = radius1 + radius2;
+	return Vector2DistanceSqr(center1, center2) <= (radii * radii);
+}
+
+bool point_near_segment(Vector2 point, Vector2 start, Vector2 end, float threshold)
+{
+	Vector2 segment = Vector2Subtract(end, start);
+	float length_sqr = Vector2LengthSqr(segment);
+	float t = (length_sqr > 0) ? Clamp(Vector2DotProduct(Vector2Subtract(point, start), segment) / length_sqr, 0, 1) : 0;
+
+	return Vector2Distance(point, Vector2Add(start, Vector2Scale(segment, t))) <= threshold;
+}
@@ -2,8 +2,9 @@
 #include "headers/raylib.h"
 #include "headers/raymath.h"
 #include "headers/circle.h"
-#include "headers/physics.h"
-#include "headers/spatial_partition.h"
+#include "headers/world.h"
+#include "headers/render.h"
+#include "headers/sim_thread.h"
 
 #define RAYGUI_IMPLEMENTATION
 #include "headers/raygui.h"
@@ -13,6 +14,11 @@
 
 const int FPS = 60;
 const int SUB_STEPS = 8;
+const int MIN_SUB_STEPS = 4;
+// a step has to fit in a 60fps frame with room left for the snapshot copy and a catch up step
+const float STEP_BUDGET_MS = 12.0f;
+const int WORKERS = 4;
+const int REORDER_INTERVAL = 120;
 
 const int SCRH = 900;
 const int SCRW = 900;
@@ -21,7 +27,7 @@ const Vector2 CENTER = { SCRW / 2.0f, SCRH / 2.0f };
 const float GRAVITY = 1000.0f;
 
 const float MINR = 100.0f;
-const float MAXR = BORDER_RADIUS;
+const float MAXR = 400.0f;
 
 typedef struct
 {
@@ -54,14 +60,16 @@ Color get_random_color()
 	}
 }
 
-void add_balls(Timer* timer, Circles* circles, PlaygroundEditor pe)
+// spawn_scale is the governor's throttle on the rate the editor asks for
+void add_balls(Timer* timer, SimThread* sim, PlaygroundEditor pe, float spawn_scale)
 {
 	const int INIT_ACCEL = 20;
 
-	if((IsMouseButtonDown(MOUSE_LEFT_BUTTON)) && (timer_done(*timer)) && (CheckCollisionPointCircle(GetMousePosition(), CENTER, pe.constraint_radius)) && (Vector2Distance(GetMousePosition(), CENTER) < (pe.constraint_radius - pe.ball_radius)))
+	if((spawn_scale > 0) && (IsMouseButtonDown(MOUSE_LEFT_BUTTON)) && (timer_done(*timer)) && (CheckCollisionPointCircle(GetMousePosition(), CENTER, pe.constraint_radius)) && (Vector2Distance(GetMousePosition(), CENTER) < (pe.constraint_radius - pe.ball_radius)))
 	{
-		start_timer(timer, (1 / pe.balls_per_second));
+		start_timer(timer, (1 / (pe.balls_per_second * spawn_scale)));
 
+		SimCommand command = { .type = SIM_SPAWN };
 		VerletCirlce projectile;
 		projectile.color = get_random_color();
 		projectile.radius = pe.ball_radius;
@@ -69,25 +77,22 @@ void add_balls(Timer* timer, Circles* circles, PlaygroundEditor pe)
 		projectile.acceleration = Vector2Scale(Vector2Normalize(Vector2Subtract(GetMousePosition(), CENTER)), (GRAVITY * INIT_ACCEL * -1));
 		projectile.previous_position = projectile.current_position = GetMousePosition();
 
-		add_verlet_circle(circles,projectile);
+		command.circle = projectile;
+		sim_send(sim, command);
 	}
 }
 
-void handle_ball_overflow(Circles* circles, int ball_capacity)
+void handle_ball_overflow(SimThread* sim, int ball_count, int ball_capacity)
 {
-	while((circles->size > ball_capacity))
-		circles->size--;            
+	if(ball_count > ball_capacity)
+		sim_send(sim, (SimCommand){ .type = SIM_TRIM, .count = ball_capacity });
 }
 
-void remove_balls(Circles* circles)
+void remove_balls(SimThread* sim)
 {
 	const int ERASER_SIZE = 10;
 
-	for(int i = 0; i < circles->size; i++)
-	{
-		if(CheckCollisionCircles(GetMousePosition(), ERASER_SIZE, circles->circle[i].current_position, circles->circle[i].radius))
-			delete_verlet_circle(circles, i);
-	}
+	sim_send(sim, (SimCommand){ .type = SIM_ERASE, .center = GetMousePosition(), .radius = ERASER_SIZE });
 }
 
 float max_circle_count(float R, float r)
@@ -95,14 +100,14 @@ float max_circle_count(float R, float r)
 	return (0.83 * (powf(R, 2) / powf(r, 2)) - 1.9);
 }
 
-float average_radius(Circles* circles)
+float average_radius(const WorldSnapshot* snapshot)
 {
 	float average_r = 0;
 
-	for(int i = 0; i < circles->size; i++) 
-		average_r += circles->circle[i].radius;
+	for(int i = 0; i < snapshot->size; i++) 
+		average_r += snapshot->radius[i];
 
-	return (circles->size > 0) ? (average_r / circles->size) : 5;
+	return (snapshot->size > 0) ? (average_r / snapshot->size) : 5;
 }
 
 void change_playground_statistics(PlaygroundEditor* statistics, int ball_count)
@@ -125,20 +130,31 @@ void change_playground_statistics(PlaygroundEditor* statistics, int ball_count)
 	DrawText(text, 5, 79, 10, GRAY);
 }
 
-void update_circles(Circles* circles, Grid grid[ROW][COL], PlaygroundEditor statistics, float dt)
+// the lower of what fits in the border and what the governor allows
+int ball_capacity(const WorldSnapshot* snapshot, float fitting)
 {
-	clear_grid_index_lists(grid);
+	if((snapshot->circle_cap != NO_CIRCLE_CAP) && (snapshot->circle_cap < fitting))
+		return snapshot->circle_cap;
 
-	int i = 0;
-	for(VerletCirlce* vc = (circles->circle + i); (i < circles->size); i++, vc = (circles->circle + i))
-	{
-		add_circle_to_grid(grid, i, vc->current_position);
-		update_position(vc, 0.995, dt);
-		apply_gravity(vc, (Vector2){ 0, statistics.gravity_strength }, GetFrameTime());
-		handle_border_collision(vc, CENTER, (Vector2){ 0, statistics.gravity_strength }, statistics.constraint_radius);
-	}
+	return fitting;
+}
 
-	grid_circle_collision(grid, circles);
+void draw_governor_status(int substeps, float spawn_scale, int circle_cap)
+{
+	char text[100];
+
+	if(circle_cap == NO_CIRCLE_CAP)
+		sprintf(text, "SUB STEPS: %d  SPAWN RATE: %.0f%%", substeps, (spawn_scale * 100));
+	else
+		sprintf(text, "SUB STEPS: %d  SPAWN RATE: %.0f%%  CAPPED AT %d", substeps, (spawn_scale * 100), circle_cap);
+
+	DrawText(text, 5, 91, 10, GRAY);
+}
+
+void apply_playground_settings(SimThread* sim, PlaygroundEditor statistics)
+{
+	sim_send(sim, (SimCommand){ .type = SIM_GRAVITY, .gravity = { 0, statistics.gravity_strength } });
+	sim_send(sim, (SimCommand){ .type = SIM_BORDER, .radius = statistics.constraint_radius });
 }
 
 void init()
@@ -148,47 +164,96 @@ void init()
 	InitWindow(SCRW, SCRH, "Verlet Circle Playground");
 }
 
-void deinit(VerletCirlce* alloc_circle_mem, Grid grid[ROW][COL])
+void deinit(VerletWorld* world, CircleBatch* batch)
 {
-	free(alloc_circle_mem);
-	dealloc_grid(grid);
+	dealloc_circle_batch(batch);
+	dealloc_world(world);
 	CloseWindow();
 }
 
 int main()
 {
-	Circles circles = create_circles();
-	Grid grid[ROW][COL];
+	VerletWorld world = create_world();
 	Timer add_ball_timer;
 
 	PlaygroundEditor settings = create_editor();
+	ProfileSummary profile = create_profile_summary(0.5f);
+	bool show_profile = false;
+
+	// VERLET_TRACE=file.json records the session as a chrome trace, written on T and at exit
+	const char* trace_path = getenv("VERLET_TRACE");
+	ProfileTrace trace = { 0 };
+
+	profile_name_thread("render");
+
+	if(trace_path != NULL)
+		trace = create_profile_trace(0);
 
 	init();
-	create_grid(grid, CENTER);
+	CircleBatch batch = create_circle_batch(world.circles.capacity);
+	world.collide = true;
+	world.broadphase = NEIGHBOR_LIST;
+	world.sleeping = true;
+	world.worker_count = WORKERS;
+	world.reorder_interval = REORDER_INTERVAL;
+	world.bounded = true;
+	world.border_center = CENTER;
+
+	SimThread* sim = start_sim_thread(&world, SUB_STEPS);
+	sim_send(sim, (SimCommand){ .type = SIM_GOVERN, .governor = create_governor(STEP_BUDGET_MS, MIN_SUB_STEPS, SUB_STEPS) });
 	
 	while(!WindowShouldClose())
 	{
-		float dt = GetFrameTime() / SUB_STEPS;
-		float mcc = max_circle_count(settings.constraint_radius, average_radius(&circles));
+		const WorldSnapshot* snapshot = acquire_snapshot(sim);
+		float mcc = max_circle_count(settings.constraint_radius, average_radius(snapshot));
 
-		add_balls(&add_ball_timer, &circles, settings);
-		handle_ball_overflow(&circles, mcc);
+		add_balls(&add_ball_timer, sim, settings, snapshot->spawn_scale);
+		handle_ball_overflow(sim, snapshot->size, ball_capacity(snapshot, mcc));
 		
 		if(IsMouseButtonDown(MOUSE_RIGHT_BUTTON)) 
-			remove_balls(&circles);
+			remove_balls(sim);
+
+		apply_playground_settings(sim, settings);
+
+		if(IsKeyPressed(KEY_P))
+			show_profile = !show_profile;
 
-		for(int i = 0; i < SUB_STEPS; i++) 
-			update_circles(&circles, grid, settings, dt);   
+		if(IsKeyPressed(KEY_H))
+			write_profile_histograms(&profile, "latency.csv");
+
+		if(trace_path != NULL)
+		{
+			poll_profile_trace(&trace);
+
+			if(IsKeyPressed(KEY_T))
+				write_profile_trace(&trace, trace_path);
+		}
 		
 		BeginDrawing();
 			ClearBackground(BLACK);
-			draw_circles(&circles);
+			draw_circle_batch(&batch, snapshot);
+			int ball_count = snapshot->size, substeps = snapshot->substeps, circle_cap = snapshot->circle_cap;
+			float spawn_scale = snapshot->spawn_scale;
+			release_snapshot(sim);
+
 			DrawFPS(SCRW - 75, 0);
-			change_playground_statistics(&settings, circles.size);
+			change_playground_statistics(&settings, ball_count);
+			draw_governor_status(substeps, spawn_scale, circle_cap);
 			DrawCircleLinesV(CENTER, settings.constraint_radius, RAYWHITE);
+
+			profile_collect(&profile);
+			if(show_profile) draw_profile_overlay(&profile, 5, SCRH - PROFILE_OVERLAY_HEIGHT - 5);
 		EndDrawing();
 	}
 	
-	deinit(circles.circle, grid);
+	stop_sim_thread(sim);
+
+	if(trace_path != NULL)
+	{
+		write_profile_trace(&trace, trace_path);
+		dealloc_profile_trace(&trace);
+	}
+
+	deinit(&world, &batch);
 	return 0;    
-}
\ No newline at end of file
+}
@@ -0,0 +1,369 @@
+#include "headers/profile.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// seconds of frames the tail percentiles cover, between one and two of these
+static const float HISTOGRAM_WINDOW = 5.0f;
+
+static _Atomic(ProfileBuffer*) buffers[PROFILE_THREADS];
+static atomic_int claimed = 0;
+static atomic_int open_traces = 0;
+static atomic_llong unrecorded = 0;    // events from threads that found no ring
+
+// the ring of the calling thread, NULL once every ring is taken
+static _Thread_local ProfileBuffer* own_buffer = NULL;
+static _Thread_local bool own_claimed = false;
+
+long long profile_now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec * 1000000000LL) + now.tv_nsec;
+}
+
+// a released ring of the same name, so a pool made again records its workers on the tracks of the last one
+static ProfileBuffer* reuse_buffer(const char* name)
+{
+	for(int t = 0; t < profile_thread_count(); t++)
+	{
+		ProfileBuffer* buffer = profile_buffer(t);
+		bool released = false;
+
+		if((buffer != NULL) && (strcmp(buffer->name, name) == 0) && atomic_compare_exchange_strong(&buffer->in_use, &released, true))
+			return buffer;
+	}
+
+	return NULL;
+}
+
+// rings are claimed on a thread's first event and kept for the life of the process, they are read after the thread is
+// gone. a named thread first takes over a ring released by one of the same name
+static ProfileBuffer* claim_buffer(const char* name)
+{
+	own_claimed = true;
+
+	if(name != NULL)
+	{
+		ProfileBuffer* reused = reuse_buffer(name);
+
+		if(reused != NULL)
+			return reused;
+	}
+
+	int thread = atomic_fetch_add(&claimed, 1);
+
+	if(thread >= PROFILE_THREADS)
+		return NULL;
+
+	ProfileBuffer* buffer = calloc(1, sizeof(ProfileBuffer));
+	buffer->thread = thread;
+	atomic_init(&buffer->in_use, true);
+
+	if(name != NULL)
+		snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+	else
+		snprintf(buffer->name, sizeof(buffer->name), "thread %d", thread);
+
+	atomic_store_explicit(&buffers[thread], buffer, memory_order_release);
+
+	return buffer;
+}
+
+// names the calling thread in traces, only before it has recorded anything
+void profile_name_thread(const char* name)
+{
+	if(!own_claimed)
+		own_buffer = claim_buffer(name);
+}
+
+// gives the calling thread's ring up for the next thread of its name, called by threads about to exit
+void profile_release_thread()
+{
+	if(own_buffer != NULL)
+		atomic_store_explicit(&own_buffer->in_use, false, memory_order_release);
+
+	own_buffer = NULL;
+	own_claimed = false;
+}
+
+void profile_record_step(ProfileZone zone, long long start, long long end, int step, int substep)
+{
+	if(!own_claimed)
+		own_buffer = claim_buffer(NULL);
+
+	if(own_buffer == NULL)
+	{
+		atomic_fetch_add_explicit(&unrecorded, 1, memory_order_relaxed);
+		return;
+	}
+
+	unsigned long head = atomic_load_explicit(&own_buffer->head, memory_order_relaxed);
+	ProfileEvent* event = &own_buffer->events[head & (PROFILE_EVENTS - 1)];
+
+	atomic_store_explicit(&event->zone, zone, memory_order_relaxed);
+	atomic_store_explicit(&event->start, start, memory_order_relaxed);
+	atomic_store_explicit(&event->end, end, memory_order_relaxed);
+	atomic_store_explicit(&event->step, step, memory_order_relaxed);
+	atomic_store_explicit(&event->substep, substep, memory_order_relaxed);
+	atomic_store_explicit(&own_buffer->head, head + 1, memory_order_release);
+}
+
+void profile_record(ProfileZone zone, long long start, long long end)
+{
+	profile_record_step(zone, start, end, -1, -1);
+}
+
+const char* profile_zone_name(ProfileZone zone)
+{
+	static const char* names[PROFILE_ZONE_COUNT] = { "step", "substep", "grid clear", "grid insert", "neighbors", "integrate", "border", "narrowphase", "links", "render" };
+
+	return ((zone >= 0) && (zone < PROFILE_ZONE_COUNT)) ? names[zone] : "unknown";
+}
+
+int profile_thread_count()
+{
+	int count = atomic_load(&claimed);
+
+	return (count < PROFILE_THREADS) ? count : PROFILE_THREADS;
+}
+
+// NULL for a ring claimed but not published yet
+ProfileBuffer* profile_buffer(int thread)
+{
+	return atomic_load_explicit(&buffers[thread], memory_order_acquire);
+}
+
+// hands every event of a ring past *read to visit and moves *read up to the head, returns how many were overwritten
+// before they could be read. a ring that went round more than once since is read from its oldest event
+static long long read_ring(ProfileBuffer* buffer, unsigned long* read, void (*visit)(void* context, int thread, const ProfileEvent* event), void* context)
+{
+	unsigned long head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+	unsigned long cursor = *read;
+	long long lost = 0;
+
+	if(head - cursor > PROFILE_EVENTS)
+	{
+		lost = (head - cursor) - PROFILE_EVENTS;
+		cursor = head - PROFILE_EVENTS;
+	}
+
+	for(; cursor != head; cursor++)
+		visit(context, buffer->thread, &buffer->events[cursor & (PROFILE_EVENTS - 1)]);
+
+	*read = head;
+
+	return lost;
+}
+
+static void skip_ring(ProfileBuffer* buffer, unsigned long* read)
+{
+	*read = atomic_load_explicit(&buffer->head, memory_order_acquire);
+}
+
+ProfileSummary create_profile_summary(float window_seconds)
+{
+	ProfileSummary summary = { 0 };
+
+	summary.window_ns = window_seconds * 1e9;
+	summary.window_start = profile_now();
+	summary.frame_times = create_rolling_histogram(HISTOGRAM_WINDOW, summary.window_start);
+	summary.step_times = create_rolling_histogram(HISTOGRAM_WINDOW, summary.window_start);
+	summary.last_frame = 0;
+
+	// events from before the summary was made are not its business
+	for(int t = 0; t < profile_thread_count(); t++)
+		if(profile_buffer(t) != NULL)
+			skip_ring(profile_buffer(t), &summary.read[t]);
+
+	return summary;
+}
+
+static void sum_event(void* context, int thread, const ProfileEvent* event)
+{
+	ProfileSummary* summary = context;
+	int zone = atomic_load_explicit(&event->zone, memory_order_relaxed);
+
+	if((zone < 0) || (zone >= PROFILE_ZONE_COUNT))
+		return;
+
+	long long end = atomic_load_explicit(&event->end, memory_order_relaxed);
+	long long duration = end - atomic_load_explicit(&event->start, memory_order_relaxed);
+
+	summary->total_ns[zone] += duration;
+	summary->calls[zone]++;
+
+	if(zone == PROFILE_STEP)
+		record_rolling_histogram(&summary->step_times, duration, end);
+}
+
+// reads every event recorded since the last call and counts one frame, true when a window closed and the averages changed
+bool profile_collect(ProfileSummary* summary)
+{
+	for(int t = 0; t < profile_thread_count(); t++)
+		if(profile_buffer(t) != NULL)
+			read_ring(profile_buffer(t), &summary->read[t], sum_event, summary);
+
+	summary->window_frames++;
+
+	long long now = profile_now();
+
+	if(summary->last_frame != 0)
+		record_rolling_histogram(&summary->frame_times, (now - summary->last_frame), now);
+
+	summary->last_frame = now;
+
+	if(now - summary->window_start < summary->window_ns)
+		return false;
+
+	for(int z = 0; z < PROFILE_ZONE_COUNT; z++)
+	{
+		summary->ms_per_frame[z] = (summary->total_ns[z] / 1e6) / summary->window_frames;
+		summary->calls_per_frame[z] = summary->calls[z] / (float)summary->window_frames;
+		summary->total_ns[z] = 0;
+		summary->calls[z] = 0;
+	}
+
+	summary->window_frames = 0;
+	summary->window_start = now;
+
+	return true;
+}
+
+// the frame and step histograms as they stand, both windows of each
+bool write_profile_histograms(const ProfileSummary* summary, const char* path)
+{
+	FILE* file = fopen(path, "w");
+	Histogram view;
+
+	if(file == NULL)
+		return false;
+
+	fprintf(file, "series,low_ms,high_ms,count,cumulative\n");
+
+	rolling_histogram_view(&summary->frame_times, &view);
+	bool written = write_histogram_csv(file, "frame", &view);
+
+	rolling_histogram_view(&summary->step_times, &view);
+	written = written && write_histogram_csv(file, "step", &view);
+
+	return (fclose(file) == 0) && written;
+}
+
+// 0 keeps up to four million events, about 128MB
+ProfileTrace create_profile_trace(int max_events)
+{
+	ProfileTrace trace = { 0 };
+
+	trace.max_events = (max_events > 0) ? max_events : (1 << 22);
+	trace.capacity = 4096;
+	trace.events = malloc(sizeof(TraceEvent) * trace.capacity);
+	trace.origin = profile_now();
+	trace.unrecorded = atomic_load(&unrecorded);
+
+	for(int t = 0; t < profile_thread_count(); t++)
+		if(profile_buffer(t) != NULL)
+			skip_ring(profile_buffer(t), &trace.read[t]);
+
+	atomic_fetch_add(&open_traces, 1);
+
+	return trace;
+}
+
+// substep events cost the step two extra tasks each, so the world only records them while a trace is open
+bool profile_tracing()
+{
+	return atomic_load_explicit(&open_traces, memory_order_relaxed) > 0;
+}
+
+static void keep_event(void* context, int thread, const ProfileEvent* event)
+{
+	ProfileTrace* trace = context;
+
+	if(trace->count == trace->max_events)
+	{
+		trace->dropped++;
+		return;
+	}
+
+	if(trace->count == trace->capacity)
+	{
+		trace->capacity *= 2;
+		trace->events = realloc(trace->events, sizeof(TraceEvent) * trace->capacity);
+	}
+
+	TraceEvent* kept = &trace->events[trace->count++];
+
+	kept->thread = thread;
+	kept->zone = atomic_load_explicit(&event->zone, memory_order_relaxed);
+	kept->start = atomic_load_explicit(&event->start, memory_order_relaxed);
+	kept->end = atomic_load_explicit(&event->end, memory_order_relaxed);
+	kept->step = atomic_load_explicit(&event->step, memory_order_relaxed);
+	kept->substep = atomic_load_explicit(&event->substep, memory_order_relaxed);
+}
+
+// has to be called often enough that no ring wraps in between, once a frame is plenty
+void poll_profile_trace(ProfileTrace* trace)
+{
+	for(int t = 0; t < profile_thread_count(); t++)
+		if(profile_buffer(t) != NULL)
+			trace->dropped += read_ring(profile_buffer(t), &trace->read[t], keep_event, trace);
+
+	long long now_unrecorded = atomic_load(&unrecorded);
+
+	trace->dropped += now_unrecorded - trace->unrecorded;
+	trace->unrecorded = now_unrecorded;
+}
+
+// writes everything traced so far, the trace stays open and a later write rewrites the file with more.
+// steps and substeps go on a track of their own above the threads, the phases on the thread that ran them
+bool write_profile_trace(ProfileTrace* trace, const char* path)
+{
+	FILE* file = fopen(path, "w");
+	const int STEP_TRACK = PROFILE_THREADS;
+
+	if(file == NULL)
+		return false;
+
+	poll_profile_trace(trace);
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%lld},\"traceEvents\":[\n", trace->dropped);
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"verlet\"}},\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"steps\"}},\n", STEP_TRACK);
+	fprintf(file, "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":-1}}", STEP_TRACK);
+
+	for(int t = 0; t < profile_thread_count(); t++)
+		if(profile_buffer(t) != NULL)
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", t, profile_buffer(t)->name);
+
+	for(int e = 0; e < trace->count; e++)
+	{
+		TraceEvent* event = &trace->events[e];
+		bool timeline = (event->zone == PROFILE_STEP) || (event->zone == PROFILE_SUBSTEP);
+
+		// complete events in microseconds, which the format allows fractions of
+		fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", profile_zone_name(event->zone), timeline ? "step" : "phase",
+			timeline ? STEP_TRACK : event->thread, (event->start - trace->origin) / 1e3, (event->end - event->start) / 1e3);
+
+		if(event->zone == PROFILE_STEP)
+			fprintf(file, ",\"args\":{\"step\":%d}", event->step);
+		else if(event->zone == PROFILE_SUBSTEP)
+			fprintf(file, ",\"args\":{\"step\":%d,\"substep\":%d}", event->step, event->substep);
+
+		fprintf(file, "}");
+	}
+
+	fprintf(file, "\n]}\n");
+
+	return (fclose(file) == 0);
+}
+
+void dealloc_profile_trace(ProfileTrace* trace)
+{
+	free(trace->events);
+	trace->events = NULL;
+	trace->count = trace->capacity = 0;
+	atomic_fetch_sub(&open_traces, 1);
+}
@@ -0,0 +1,271 @@
+#include "headers/render.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// quads are two unindexed triangles, as 16 bit indices would cap the mesh at 16k circles
+#define QUAD_VERTICES 6
+#define CIRCLE_TEXTURE_SIZE 64
+
+static const float QUAD_CORNERS[QUAD_VERTICES][2] = { {-1,-1}, {-1,1}, {1,1}, {-1,-1}, {1,1}, {1,-1} };
+
+static Mesh create_batch_mesh(int capacity)
+{
+	Mesh mesh = { 0 };
+	int vertex_count = capacity * QUAD_VERTICES;
+
+	mesh.vertexCount = vertex_count;
+	mesh.triangleCount = capacity * 2;
+	mesh.vertices = MemAlloc(vertex_count * 3 * sizeof(float));
+	mesh.texcoords = MemAlloc(vertex_count * 2 * sizeof(float));
+	mesh.colors = MemAlloc(vertex_count * 4 * sizeof(unsigned char));
+
+	// texture coordinates never change, only positions and colors are streamed
+	for(int v = 0; v < vertex_count; v++)
+	{
+		mesh.texcoords[v * 2] = (QUAD_CORNERS[v % QUAD_VERTICES][0] + 1) * 0.5f;
+		mesh.texcoords[v * 2 + 1] = (QUAD_CORNERS[v % QUAD_VERTICES][1] + 1) * 0.5f;
+	}
+
+	UploadMesh(&mesh, true);
+	return mesh;
+}
+
+CircleBatch create_circle_batch(int capacity)
+{
+	CircleBatch batch;
+
+	batch.capacity = (capacity > 0) ? capacity : 1;
+	batch.mesh = create_batch_mesh(batch.capacity);
+
+	Image image = GenImageColor(CIRCLE_TEXTURE_SIZE, CIRCLE_TEXTURE_SIZE, BLANK);
+	ImageDrawCircle(&image, CIRCLE_TEXTURE_SIZE / 2, CIRCLE_TEXTURE_SIZE / 2, CIRCLE_TEXTURE_SIZE / 2 - 1, WHITE);
+	Texture2D texture = LoadTextureFromImage(image);
+	SetTextureFilter(texture, TEXTURE_FILTER_BILINEAR);
+	UnloadImage(image);
+
+	batch.material = LoadMaterialDefault();
+	SetMaterialTexture(&batch.material, MATERIAL_MAP_DIFFUSE, texture);
+
+	return batch;
+}
+
+// drawn straight away rather than through the shape batch, so call it before any shapes meant to be on top
+void draw_circle_batch(CircleBatch* batch, const WorldSnapshot* snapshot)
+{
+	PROFILE_SCOPE(PROFILE_RENDER);
+
+	if(snapshot->size == 0)
+		return;
+
+	if(snapshot->size > batch->capacity)
+	{
+		while(batch->capacity < snapshot->size)
+			batch->capacity *= 2;
+
+		UnloadMesh(batch->mesh);
+		batch->mesh = create_batch_mesh(batch->capacity);
+	}
+
+	float* vertices = batch->mesh.vertices;
+	unsigned char* colors = batch->mesh.colors;
+
+	for(int c = 0; c < snapshot->size; c++)
+	{
+		float cx = snapshot->x[c], cy = snapshot->y[c], r = snapshot->radius[c];
+		Color color = snapshot->color[c];
+
+		for(int v = 0; v < QUAD_VERTICES; v++)
+		{
+			*vertices++ = cx + QUAD_CORNERS[v][0] * r;
+			*vertices++ = cy + QUAD_CORNERS[v][1] * r;
+			*vertices++ = 0;
+
+			*colors++ = color.r;
+			*colors++ = color.g;
+			*colors++ = color.b;
+			*colors++ = color.a;
+		}
+	}
+
+	int vertex_count = snapshot->size * QUAD_VERTICES;
+
+	// buffer 0 holds positions and 3 holds colors, only the live prefix is sent and drawn
+	UpdateMeshBuffer(batch->mesh, 0, batch->mesh.vertices, vertex_count * 3 * sizeof(float), 0);
+	UpdateMeshBuffer(batch->mesh, 3, batch->mesh.colors, vertex_count * 4 * sizeof(unsigned char), 0);
+
+	Mesh live = batch->mesh;
+	live.vertexCount = vertex_count;
+	live.triangleCount = snapshot->size * 2;
+	DrawMesh(live, batch->material, MatrixIdentity());
+}
+
+void dealloc_circle_batch(CircleBatch* batch)
+{
+	UnloadMesh(batch->mesh);
+	UnloadMaterial(batch->material);
+	*batch = (CircleBatch){ 0 };
+}
+
+#define LINK_WIDTH 1.0f
+#define LINK_QUAD_VERTICES 4
+#define LINK_QUAD_INDICIES 6
+
+// raylib's vertex buffer slot for the index buffer
+#define MESH_INDEX_BUFFER 6
+
+static Mesh create_link_mesh()
+{
+	Mesh mesh = { 0 };
+
+	mesh.vertexCount = LINK_BATCH_LINKS * LINK_QUAD_VERTICES;
+	mesh.triangleCount = LINK_BATCH_LINKS * 2;
+	mesh.vertices = MemAlloc(mesh.vertexCount * 3 * sizeof(float));
+	mesh.texcoords = MemAlloc(mesh.vertexCount * 2 * sizeof(float));
+	mesh.indices = MemAlloc(LINK_BATCH_LINKS * LINK_QUAD_INDICIES * sizeof(unsigned short));
+
+	UploadMesh(&mesh, true);
+	return mesh;
+}
+
+LinkBatch create_link_batch(Color color)
+{
+	LinkBatch batch = { 0 };
+
+	batch.material = LoadMaterialDefault();
+	batch.material.maps[MATERIAL_MAP_DIFFUSE].color = color;
+	batch.built_size = -1;
+
+	return batch;
+}
+
+// writes the indicies of every live link into the mesh its slot falls in, so torn links drop out of the draw
+static void compact_link_indicies(LinkBatch* batch, const WorldSnapshot* snapshot)
+{
+	for(int m = 0; m < batch->mesh_count; m++)
+		batch->live_links[m] = 0;
+
+	for(int l = 0; l < snapshot->link_count; l++)
+	{
+		if(!snapshot->alive[l])
+			continue;
+
+		int m = l / LINK_BATCH_LINKS;
+		unsigned short base = (l % LINK_BATCH_LINKS) * LINK_QUAD_VERTICES;
+		unsigned short* indicies = batch->meshes[m].indices + (batch->live_links[m]++ * LINK_QUAD_INDICIES);
+
+		indicies[0] = base; indicies[1] = base + 1; indicies[2] = base + 2;
+		indicies[3] = base; indicies[4] = base + 2; indicies[5] = base + 3;
+	}
+
+	for(int m = 0; m < batch->mesh_count; m++)
+		if(batch->live_links[m] > 0)
+			UpdateMeshBuffer(batch->meshes[m], MESH_INDEX_BUFFER, batch->meshes[m].indices, batch->live_links[m] * LINK_QUAD_INDICIES * sizeof(unsigned short), 0);
+
+	batch->built_size = snapshot->link_count;
+	batch->built_alive = snapshot->alive_links;
+	batch->built_compactions = snapshot->link_compactions;
+}
+
+void draw_link_batch(LinkBatch* batch, const WorldSnapshot* snapshot)
+{
+	PROFILE_SCOPE(PROFILE_RENDER);
+
+	int mesh_count = (snapshot->link_count + LINK_BATCH_LINKS - 1) / LINK_BATCH_LINKS;
+
+	if(mesh_count > batch->mesh_count)
+	{
+		batch->meshes = realloc(batch->meshes, mesh_count * sizeof(Mesh));
+		batch->live_links = realloc(batch->live_links, mesh_count * sizeof(int));
+
+		for(int m = batch->mesh_count; m < mesh_count; m++)
+			batch->meshes[m] = create_link_mesh();
+
+		batch->mesh_count = mesh_count;
+		batch->built_size = -1;
+	}
+
+	if((batch->built_size != snapshot->link_count) || (batch->built_alive != snapshot->alive_links) || (batch->built_compactions != snapshot->link_compactions))
+		compact_link_indicies(batch, snapshot);
+
+	// positions are refreshed in place, dead slots are left stale as no index points at them
+	for(int l = 0; l < snapshot->link_count; l++)
+	{
+		if(!snapshot->alive[l])
+			continue;
+
+		int c1 = snapshot->circle1[l], c2 = snapshot->circle2[l];
+		Vector2 a = { snapshot->x[c1], snapshot->y[c1] }, b = { snapshot->x[c2], snapshot->y[c2] };
+		Vector2 direction = Vector2Normalize(Vector2Subtract(b, a));
+		Vector2 n = { -direction.y * (LINK_WIDTH * 0.5f), direction.x * (LINK_WIDTH * 0.5f) };
+
+		// a-n, a+n, b+n, b-n keeps both triangles wound counter clockwise on screen whatever the direction
+		float* v = batch->meshes[l / LINK_BATCH_LINKS].vertices + ((l % LINK_BATCH_LINKS) * LINK_QUAD_VERTICES * 3);
+
+		v[0] = a.x - n.x; v[1] = a.y - n.y;  v[2] = 0;
+		v[3] = a.x + n.x; v[4] = a.y + n.y;  v[5] = 0;
+		v[6] = b.x + n.x; v[7] = b.y + n.y;  v[8] = 0;
+		v[9] = b.x - n.x; v[10] = b.y - n.y; v[11] = 0;
+	}
+
+	for(int m = 0; m < batch->mesh_count; m++)
+	{
+		if(batch->live_links[m] == 0)
+			continue;
+
+		int slots = snapshot->link_count - (m * LINK_BATCH_LINKS);
+
+		if(slots > LINK_BATCH_LINKS)
+			slots = LINK_BATCH_LINKS;
+
+		UpdateMeshBuffer(batch->meshes[m], 0, batch->meshes[m].vertices, slots * LINK_QUAD_VERTICES * 3 * sizeof(float), 0);
+
+		Mesh live = batch->meshes[m];
+		live.triangleCount = batch->live_links[m] * 2;
+		DrawMesh(live, batch->material, MatrixIdentity());
+	}
+}
+
+void dealloc_link_batch(LinkBatch* batch)
+{
+	for(int m = 0; m < batch->mesh_count; m++)
+		UnloadMesh(batch->meshes[m]);
+
+	free(batch->meshes);
+	free(batch->live_links);
+	UnloadMaterial(batch->material);
+	*batch = (LinkBatch){ 0 };
+}
+
+static void draw_percentiles(const char* label, const RollingHistogram* rolling, int x, int y)
+{
+	Histogram view;
+	char text[64];
+
+	rolling_histogram_view(rolling, &view);
+	snprintf(text, sizeof(text), "p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms", histogram_percentile(&view, 50) / 1e6, histogram_percentile(&view, 95) / 1e6,
+		histogram_percentile(&view, 99) / 1e6, view.max / 1e6);
+
+	DrawText(label, x, y, 10, GRAY);
+	DrawText(text, x + 70, y, 10, GRAY);
+}
+
+// one line per zone, milliseconds a frame summed over every thread and how many times it ran, then the tail of frame and step times
+void draw_profile_overlay(const ProfileSummary* summary, int x, int y)
+{
+#ifdef VERLET_PROFILE
+	for(int z = 0; z < PROFILE_ZONE_COUNT; z++)
+	{
+		char text[32];
+
+		snprintf(text, sizeof(text), "%.2f ms x%.0f", summary->ms_per_frame[z], summary->calls_per_frame[z]);
+		DrawText(profile_zone_name(z), x, y + (z * PROFILE_OVERLAY_LINE), 10, GRAY);
+		DrawText(text, x + 70, y + (z * PROFILE_OVERLAY_LINE), 10, GRAY);
+	}
+
+	draw_percentiles("step", &summary->step_times, x, y + ((PROFILE_ZONE_COUNT + 1) * PROFILE_OVERLAY_LINE));
+#else
+	DrawText("PROFILING COMPILED OUT", x, y, 10, GRAY);
+#endif
+
+	draw_percentiles("frame", &summary->frame_times, x, y + (PROFILE_ZONE_COUNT * PROFILE_OVERLAY_LINE));
+}
@@ -0,0 +1,62 @@
+#include "headers/reorder.h"
+#include <stdlib.h>
+#include <string.h>
+
+// spreads the low 16 bits of v out to the even bits
+static uint32_t spread_bits(uint32_t v)
+{
+	v &= 0x0000FFFF;
+	v = (v | (v << 8)) & 0x00FF00FF;
+	v = (v | (v << 4)) & 0x0F0F0F0F;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+
+	return v;
+}
+
+uint32_t morton_key(uint32_t column, uint32_t row)
+{
+	return spread_bits(column) | (spread_bits(row) << 1);
+}
+
+void morton_order(Circles* circles, Vector2 origin, float cell_size, int* order)
+{
+	int n = circles->size;
+	uint32_t* keys = malloc(sizeof(uint32_t) * n * 2);
+	uint32_t* sorted_keys = keys + n;
+	int* sorted = malloc(sizeof(int) * n);
+
+	for(int i = 0; i < n; i++)
+	{
+		float column = fmaxf(((circles->x[i] - origin.x) / cell_size), 0);
+		float row = fmaxf(((circles->y[i] - origin.y) / cell_size), 0);
+
+		keys[i] = morton_key(fminf(column, 0xFFFF), fminf(row, 0xFFFF));
+		order[i] = i;
+	}
+
+	// lsd radix sort, 8 bits a pass. stable, so circles in the same cell keep their relative order
+	for(int shift = 0; shift < 32; shift += 8)
+	{
+		int count[257] = { 0 };
+
+		for(int i = 0; i < n; i++)
+			count[((keys[i] >> shift) & 0xFF) + 1]++;
+
+		for(int b = 0; b < 256; b++)
+			count[b + 1] += count[b];
+
+		for(int i = 0; i < n; i++)
+		{
+			int to = count[(keys[i] >> shift) & 0xFF]++;
+			sorted_keys[to] = keys[i];
+			sorted[to] = order[i];
+		}
+
+		memcpy(keys, sorted_keys, sizeof(uint32_t) * n);
+		memcpy(order, sorted, sizeof(int) * n);
+	}
+
+	free(keys);
+	free(sorted);
+}
@@ -0,0 +1,269 @@
+#include "headers/sim_thread.h"
+#include "headers/profile.h"
+#include <stdlib.h>
+#include <time.h>
+
+CommandQueue create_command_queue(unsigned int capacity)
+{
+	CommandQueue queue;
+
+	queue.capacity = 1;
+
+	while(queue.capacity < capacity)
+		queue.capacity *= 2;
+
+	queue.commands = malloc(queue.capacity * sizeof(SimCommand));
+	atomic_init(&queue.head, 0);
+	atomic_init(&queue.tail, 0);
+
+	return queue;
+}
+
+// false when full, the command is dropped
+bool push_command(CommandQueue* queue, SimCommand command)
+{
+	unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+	if((tail - atomic_load_explicit(&queue->head, memory_order_acquire)) == queue->capacity)
+		return false;
+
+	queue->commands[tail & (queue->capacity - 1)] = command;
+	atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+
+	return true;
+}
+
+bool pop_command(CommandQueue* queue, SimCommand* command)
+{
+	unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+	if(head == atomic_load_explicit(&queue->tail, memory_order_acquire))
+		return false;
+
+	*command = queue->commands[head & (queue->capacity - 1)];
+	atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+
+	return true;
+}
+
+void dealloc_command_queue(CommandQueue* queue)
+{
+	free(queue->commands);
+	queue->commands = NULL;
+}
+
+static double monotonic_seconds()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + (now.tv_nsec * 1e-9);
+}
+
+// keeps the handles of spawned circles in the order they came, for SIM_TRIM. erased circles leave dead handles
+// behind, which are dropped whenever the list fills before it is grown
+static void remember_spawn(SimThread* sim, CircleHandle handle)
+{
+	if(sim->spawned_count == (int)sim->spawned_capacity)
+	{
+		int kept = 0;
+
+		for(int h = 0; h < sim->spawned_count; h++)
+			if(circle_index(&sim->world->circles, sim->spawned[h]) != -1)
+				sim->spawned[kept++] = sim->spawned[h];
+
+		sim->spawned_count = kept;
+
+		// grown while mostly live, so a full list is not swept again on the very next spawn
+		if(kept * 2 > (int)sim->spawned_capacity)
+		{
+			sim->spawned_capacity *= 2;
+			sim->spawned = realloc(sim->spawned, sizeof(CircleHandle) * sim->spawned_capacity);
+		}
+	}
+
+	sim->spawned[sim->spawned_count++] = handle;
+}
+
+static void apply_command(SimThread* sim, SimCommand command)
+{
+	VerletWorld* world = sim->world;
+
+	switch(command.type)
+	{
+		case SIM_INPUT:
+			if(!command.grab)
+			{
+				CircleHandle picked = world_pick(world, command.input.cursor);
+
+				if(picked.slot != -1)
+					sim->hovered = picked;
+			}
+
+			command.input.grabbed = command.grab ? sim->hovered : NO_CIRCLE;
+			world_set_input(world, command.input);
+			break;
+
+		case SIM_SPAWN:
+			remember_spawn(sim, add_verlet_circle(&world->circles, command.circle));
+			break;
+
+		case SIM_ERASE:
+			world_erase(world, command.center, command.radius);
+			break;
+
+		// newest spawned first, indicies say nothing about age once circles are deleted or reordered
+		case SIM_TRIM:
+			while((world->circles.size > command.count) && (sim->spawned_count > 0))
+				delete_circle_handle(&world->circles, sim->spawned[--sim->spawned_count]);
+
+			while(world->circles.size > command.count)
+				delete_verlet_circle(&world->circles, world->circles.size - 1);
+			break;
+
+		case SIM_GRAVITY:
+			world->gravity = command.gravity;
+			break;
+
+		case SIM_BORDER:
+			world->border_radius = command.radius;
+			break;
+
+		case SIM_GOVERN:
+			sim->governor = command.governor;
+			sim->governed = true;
+			sim->substeps = sim->governor.substeps;
+			break;
+	}
+}
+
+// the snapshot the render thread is not holding is written outside the lock, it can only take the latest one
+static void publish_snapshot(SimThread* sim)
+{
+	pthread_mutex_lock(&sim->lock);
+	int target = (sim->latest == 0) ? 1 : 0;
+	bool busy = (sim->reading == target);
+	pthread_mutex_unlock(&sim->lock);
+
+	// the render thread still holds the older snapshot, this one is skipped and the next advance publishes
+	if(busy)
+		return;
+
+	snapshot_world(&sim->snapshots[target], sim->world);
+	sim->snapshots[target].substeps = sim->substeps;
+	sim->snapshots[target].spawn_scale = sim->governed ? sim->governor.spawn_scale : 1;
+	sim->snapshots[target].circle_cap = sim->governed ? sim->governor.circle_cap : NO_CIRCLE_CAP;
+
+	pthread_mutex_lock(&sim->lock);
+	sim->latest = target;
+	pthread_mutex_unlock(&sim->lock);
+}
+
+static void* simulate(void* arg)
+{
+	SimThread* sim = arg;
+	VerletWorld* world = sim->world;
+	double last = monotonic_seconds();
+
+	profile_name_thread("simulation");
+
+	while(atomic_load(&sim->running))
+	{
+		SimCommand command;
+
+		while(pop_command(&sim->queue, &command))
+			apply_command(sim, command);
+
+		double now = monotonic_seconds();
+		int steps = world_advance(world, (float)(now - last), sim->substeps);
+		last = now;
+
+		// the cost of a step is what the advance took per step, interpolation and all
+		if(sim->governed && (steps > 0))
+		{
+			govern(&sim->governor, (float)((monotonic_seconds() - now) * 1000 / steps), world->circles.size);
+			sim->substeps = sim->governor.substeps;
+		}
+
+		publish_snapshot(sim);
+
+		// sleep until the next step is due
+		double wait = world->fixed_dt - world->accumulator;
+
+		if(wait > 0)
+		{
+			struct timespec pause = { (time_t)wait, (long)((wait - (time_t)wait) * 1e9) };
+			nanosleep(&pause, NULL);
+		}
+	}
+
+	profile_release_thread();
+	close_counters();
+	return NULL;
+}
+
+SimThread* start_sim_thread(VerletWorld* world, int substeps)
+{
+	SimThread* sim = malloc(sizeof(SimThread));
+
+	sim->world = world;
+	sim->substeps = substeps;
+	atomic_init(&sim->running, true);
+	sim->queue = create_command_queue(1024);
+	sim->hovered = NO_CIRCLE;
+	sim->governed = false;
+	sim->spawned_capacity = 256;
+	sim->spawned = malloc(sizeof(CircleHandle) * sim->spawned_capacity);
+	sim->spawned_count = 0;
+
+	pthread_mutex_init(&sim->lock, NULL);
+	sim->snapshots[0] = create_snapshot();
+	sim->snapshots[1] = create_snapshot();
+	sim->reading = -1;
+
+	// the first snapshot is taken here so the render thread always has one
+	snapshot_world(&sim->snapshots[0], world);
+	sim->snapshots[0].substeps = substeps;
+	sim->latest = 0;
+
+	pthread_create(&sim->thread, NULL, simulate, sim);
+
+	return sim;
+}
+
+// called from the render thread only, false when the queue is full
+bool sim_send(SimThread* sim, SimCommand command)
+{
+	return push_command(&sim->queue, command);
+}
+
+// the latest snapshot, held until release_snapshot. one may be held at a time
+const WorldSnapshot* acquire_snapshot(SimThread* sim)
+{
+	pthread_mutex_lock(&sim->lock);
+	sim->reading = sim->latest;
+	pthread_mutex_unlock(&sim->lock);
+
+	return &sim->snapshots[sim->reading];
+}
+
+void release_snapshot(SimThread* sim)
+{
+	pthread_mutex_lock(&sim->lock);
+	sim->reading = -1;
+	pthread_mutex_unlock(&sim->lock);
+}
+
+// joins the thread, the world is left for its owner to free
+void stop_sim_thread(SimThread* sim)
+{
+	atomic_store(&sim->running, false);
+	pthread_join(sim->thread, NULL);
+
+	dealloc_command_queue(&sim->queue);
+	dealloc_snapshot(&sim->snapshots[0]);
+	dealloc_snapshot(&sim->snapshots[1]);
+	free(sim->spawned);
+	pthread_mutex_destroy(&sim->lock);
+	free(sim);
+}
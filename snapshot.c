@@ -0,0 +1,75 @@
+#include "headers/snapshot.h"
+#include <stdlib.h>
+#include <string.h>
+
+WorldSnapshot create_snapshot()
+{
+	WorldSnapshot snapshot = { 0 };
+
+	snapshot.spawn_scale = 1;
+	snapshot.circle_cap = NO_CIRCLE_CAP;
+
+	return snapshot;
+}
+
+void snapshot_world(WorldSnapshot* snapshot, VerletWorld* world)
+{
+	Circles* circles = &world->circles;
+	Chain* chain = &world->chain;
+
+	if(circles->size > snapshot->capacity)
+	{
+		snapshot->capacity = circles->capacity;
+		snapshot->x = realloc(snapshot->x, snapshot->capacity * sizeof(float));
+		snapshot->y = realloc(snapshot->y, snapshot->capacity * sizeof(float));
+		snapshot->radius = realloc(snapshot->radius, snapshot->capacity * sizeof(float));
+		snapshot->color = realloc(snapshot->color, snapshot->capacity * sizeof(Color));
+	}
+
+	world_interpolate(world);
+
+	snapshot->size = circles->size;
+
+	if(circles->size > 0)
+	{
+		memcpy(snapshot->x, world->draw_x, circles->size * sizeof(float));
+		memcpy(snapshot->y, world->draw_y, circles->size * sizeof(float));
+		memcpy(snapshot->radius, circles->radius, circles->size * sizeof(float));
+		memcpy(snapshot->color, circles->color, circles->size * sizeof(Color));
+	}
+
+	sync_chain(chain, circles);
+
+	if(chain->size > snapshot->link_capacity)
+	{
+		snapshot->link_capacity = chain->capacity;
+		snapshot->circle1 = realloc(snapshot->circle1, snapshot->link_capacity * sizeof(int));
+		snapshot->circle2 = realloc(snapshot->circle2, snapshot->link_capacity * sizeof(int));
+		snapshot->alive = realloc(snapshot->alive, snapshot->link_capacity * sizeof(unsigned char));
+	}
+
+	snapshot->link_count = chain->size;
+
+	if(chain->size > 0)
+	{
+		memcpy(snapshot->circle1, chain->circle1, chain->size * sizeof(int));
+		memcpy(snapshot->circle2, chain->circle2, chain->size * sizeof(int));
+		memcpy(snapshot->alive, chain->alive, chain->size * sizeof(unsigned char));
+	}
+	snapshot->alive_links = chain->alive_count;
+	snapshot->link_compactions = chain->compactions;
+	snapshot->steps = world->steps;
+}
+
+void dealloc_snapshot(WorldSnapshot* snapshot)
+{
+	free(snapshot->x);
+	free(snapshot->y);
+	free(snapshot->radius);
+	free(snapshot->color);
+	free(snapshot->circle1);
+	free(snapshot->circle2);
+	free(snapshot->alive);
+
+	*snapshot = create_snapshot();
+}
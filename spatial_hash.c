@@ -0,0 +1,228 @@
+#include "headers/spatial_hash.h"
+#include "headers/profile.h"
+#include <string.h>
+
+static uint64_t cell_key(int r, int c)
+{
+	return ((uint64_t)(uint32_t)r << 32) | (uint32_t)c;
+}
+
+static size_t cell_hash(SpatialHash* hash, uint64_t key)
+{
+	return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (hash->table_capacity - 1);
+}
+
+static int cell_group(SpatialHash* hash, int cell)
+{
+	int r = ((hash->cell_row[cell] % GROUP_ROWS) + GROUP_ROWS) % GROUP_ROWS;
+	int c = ((hash->cell_col[cell] % GROUP_COLS) + GROUP_COLS) % GROUP_COLS;
+
+	return (r * GROUP_COLS) + c;
+}
+
+static void alloc_tables(SpatialHash* hash, size_t table_capacity, size_t cell_capacity)
+{
+	hash->table_capacity = table_capacity;
+	hash->keys = realloc(hash->keys, sizeof(uint64_t) * table_capacity);
+	hash->slots = realloc(hash->slots, sizeof(int) * table_capacity);
+
+	for(size_t e = 0; e < table_capacity; e++)
+		hash->slots[e] = -1;
+
+	hash->cell_row = realloc(hash->cell_row, sizeof(int) * cell_capacity);
+	hash->cell_col = realloc(hash->cell_col, sizeof(int) * cell_capacity);
+	hash->cell_count = realloc(hash->cell_count, sizeof(int) * cell_capacity);
+	hash->cell_start = realloc(hash->cell_start, sizeof(int) * cell_capacity);
+	hash->cell_entry = realloc(hash->cell_entry, sizeof(int) * cell_capacity);
+	hash->group_cells = realloc(hash->group_cells, sizeof(int) * cell_capacity);
+	hash->occupied_count = 0;
+}
+
+SpatialHash create_spatial_hash(float cell_size)
+{
+	SpatialHash hash = { 0 };
+
+	hash.cell_size = cell_size;
+	alloc_tables(&hash, 16, 8);
+	hash.group_start = calloc((CELL_GROUPS + 1), sizeof(int));
+
+	hash.capacity = 1;
+	hash.cell_of = malloc(sizeof(int) * hash.capacity);
+	hash.indicies = malloc(sizeof(int) * hash.capacity);
+
+	return hash;
+}
+
+// occupied cell at (r, c), -1 if nothing is there
+static int find_cell(SpatialHash* hash, int r, int c)
+{
+	uint64_t key = cell_key(r, c);
+
+	for(size_t e = cell_hash(hash, key);; e = (e + 1) & (hash->table_capacity - 1))
+	{
+		if(hash->slots[e] == -1)
+			return -1;
+
+		if(hash->keys[e] == key)
+			return hash->slots[e];
+	}
+}
+
+static int insert_cell(SpatialHash* hash, int r, int c)
+{
+	uint64_t key = cell_key(r, c);
+	size_t e = cell_hash(hash, key);
+
+	for(; hash->slots[e] != -1; e = (e + 1) & (hash->table_capacity - 1))
+		if(hash->keys[e] == key)
+			return hash->slots[e];
+
+	int cell = hash->occupied_count++;
+
+	hash->keys[e] = key;
+	hash->slots[e] = cell;
+	hash->cell_row[cell] = r;
+	hash->cell_col[cell] = c;
+	hash->cell_count[cell] = 0;
+	hash->cell_entry[cell] = e;
+
+	return cell;
+}
+
+void build_spatial_hash(SpatialHash* hash, Circles* circles)
+{
+	// at most one cell per circle, the table stays at most half full
+	size_t table_capacity = hash->table_capacity;
+
+	while(table_capacity < (2 * (size_t)circles->size))
+		table_capacity *= 2;
+
+	if(table_capacity != hash->table_capacity)
+		alloc_tables(hash, table_capacity, (table_capacity / 2));
+	else
+	{
+		PROFILE_SCOPE(PROFILE_GRID_CLEAR);
+
+		for(int cell = 0; cell < hash->occupied_count; cell++)
+			hash->slots[hash->cell_entry[cell]] = -1;
+
+		hash->occupied_count = 0;
+	}
+
+	PROFILE_SCOPE(PROFILE_GRID_INSERT);
+
+	if(circles->size > hash->capacity)
+	{
+		hash->capacity = circles->capacity;
+		hash->cell_of = realloc(hash->cell_of, sizeof(int) * hash->capacity);
+		hash->indicies = realloc(hash->indicies, sizeof(int) * hash->capacity);
+	}
+
+	hash->circle_count = circles->size;
+	hash->layout = circles->layout;
+
+	// first pass, count circles per cell
+	for(int i = 0; i < circles->size; i++)
+	{
+		int cell = insert_cell(hash, floorf(circles->y[i] / hash->cell_size), floorf(circles->x[i] / hash->cell_size));
+
+		hash->cell_count[cell]++;
+		hash->cell_of[i] = cell;
+	}
+
+	int offset = 0;
+	memset(hash->group_start, 0, sizeof(int) * (CELL_GROUPS + 1));
+
+	for(int cell = 0; cell < hash->occupied_count; cell++)
+	{
+		hash->cell_start[cell] = offset;
+		offset += hash->cell_count[cell];
+		hash->group_start[cell_group(hash, cell) + 1]++;
+	}
+
+	for(int g = 0; g < CELL_GROUPS; g++)
+		hash->group_start[g + 1] += hash->group_start[g];
+
+	// second pass, scatter circles into their cell's run. cell_start is used as a cursor and restored after
+	for(int i = 0; i < circles->size; i++)
+		hash->indicies[hash->cell_start[hash->cell_of[i]]++] = i;
+
+	for(int cell = 0; cell < hash->occupied_count; cell++)
+		hash->cell_start[cell] -= hash->cell_count[cell];
+
+	int group_cursor[CELL_GROUPS];
+	memcpy(group_cursor, hash->group_start, sizeof(group_cursor));
+
+	for(int cell = 0; cell < hash->occupied_count; cell++)
+		hash->group_cells[group_cursor[cell_group(hash, cell)]++] = cell;
+}
+
+static void collide_cell(SpatialHash* hash, Circles* circles, int cell)
+{
+	// half stencil, the cell to the right and the three cells below
+	const int NEIGHBORS[4][2] = { { 0, 1 }, { 1, -1 }, { 1, 0 }, { 1, 1 } };
+
+	int r = hash->cell_row[cell], c = hash->cell_col[cell];
+	int begin = hash->cell_start[cell];
+	int end = begin + hash->cell_count[cell];
+	int neighbors[4];
+
+	for(int n = 0; n < 4; n++)
+		neighbors[n] = find_cell(hash, (r + NEIGHBORS[n][0]), (c + NEIGHBORS[n][1]));
+
+	for(int k = begin; k < end; k++)
+	{
+		handle_verlet_circle_batch(circles, hash->indicies[k], (hash->indicies + k + 1), (end - k - 1));
+
+		for(int n = 0; n < 4; n++)
+			if(neighbors[n] != -1)
+				handle_verlet_circle_batch(circles, hash->indicies[k], (hash->indicies + hash->cell_start[neighbors[n]]), hash->cell_count[neighbors[n]]);
+	}
+}
+
+// visits the circles binned in every occupied cell overlapping the box from low to high, as of the last build
+void hash_query(SpatialHash* hash, Vector2 low, Vector2 high, CircleVisitor visit, void* context)
+{
+	int first_col = floorf(low.x / hash->cell_size), last_col = floorf(high.x / hash->cell_size);
+	int first_row = floorf(low.y / hash->cell_size), last_row = floorf(high.y / hash->cell_size);
+
+	for(int r = first_row; r <= last_row; r++)
+		for(int c = first_col; c <= last_col; c++)
+		{
+			int cell = find_cell(hash, r, c);
+
+			if(cell == -1)
+				continue;
+
+			for(int k = 0; k < hash->cell_count[cell]; k++)
+				visit(context, hash->indicies[hash->cell_start[cell] + k]);
+		}
+}
+
+int hash_group_size(SpatialHash* hash, int group)
+{
+	return hash->group_start[group + 1] - hash->group_start[group];
+}
+
+void hash_collide_group(SpatialHash* hash, Circles* circles, int group, int begin, int end)
+{
+	int* cells = hash->group_cells + hash->group_start[group];
+
+	for(int i = begin; i < end; i++)
+		collide_cell(hash, circles, cells[i]);
+}
+
+void dealloc_spatial_hash(SpatialHash* hash)
+{
+	free(hash->keys);
+	free(hash->slots);
+	free(hash->cell_row);
+	free(hash->cell_col);
+	free(hash->cell_count);
+	free(hash->cell_start);
+	free(hash->cell_entry);
+	free(hash->group_start);
+	free(hash->group_cells);
+	free(hash->cell_of);
+	free(hash->indicies);
+}
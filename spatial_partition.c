@@ -1,85 +1,237 @@
 #include "headers/spatial_partition.h"
-#include "headers/raylib.h"
+#include "headers/profile.h"
+#include <string.h>
 
-void resize_index_list(IndexList* il)
+static int cell_group(Grid* grid, int cell)
 {
-	il->capacity *= 2;
-	il->indicies = realloc(il->indicies, il->capacity);
+	return (((cell / grid->cols) % GROUP_ROWS) * GROUP_COLS) + ((cell % grid->cols) % GROUP_COLS);
 }
 
-void add_circle_index(IndexList* il, int index)
+Grid create_grid(Vector2 start, Vector2 extent, float cell_size)
 {
-	if((il->size * sizeof(int)) == il->capacity) 
-		resize_index_list(il);
-	
-	il->indicies[il->size++] = index;
+	Grid grid;
+
+	grid.start = start;
+	grid.cell_size = cell_size;
+	grid.rows = ceilf(extent.y / cell_size);
+	grid.cols = ceilf(extent.x / cell_size);
+	grid.rows = (grid.rows > 0) ? grid.rows : 1;
+	grid.cols = (grid.cols > 0) ? grid.cols : 1;
+
+	int cells = grid.rows * grid.cols;
+
+	grid.cell_count = calloc(cells, sizeof(int));
+	grid.cell_awake = calloc(cells, sizeof(int));
+	grid.cell_start = malloc(sizeof(int) * cells);
+	grid.occupied = malloc(sizeof(int) * cells);
+	grid.occupied_count = 0;
+
+	grid.group_start = calloc((CELL_GROUPS + 1), sizeof(int));
+	grid.group_cells = malloc(sizeof(int) * cells);
+
+	grid.circle_count = 0;
+	grid.layout = 0;
+	grid.capacity = 1;
+	grid.cell_of = malloc(sizeof(int) * grid.capacity);
+	grid.indicies = malloc(sizeof(int) * grid.capacity);
+
+	return grid;
+}
+
+bool grid_covers(Grid* grid, Vector2 start, Vector2 extent)
+{
+	return (start.x >= grid->start.x) && (start.y >= grid->start.y) && 
+		((start.x + extent.x) <= (grid->start.x + (grid->cols * grid->cell_size))) && 
+		((start.y + extent.y) <= (grid->start.y + (grid->rows * grid->cell_size)));
 }
 
-void create_grid(Grid grid[ROW][COL], Vector2 border_center)
+void build_grid(Grid* grid, Circles* circles)
 {
-	Vector2 current_position = { (border_center.x - BORDER_RADIUS), (border_center.y - BORDER_RADIUS) };
+	if(circles->size > grid->capacity)
+	{
+		grid->capacity = circles->capacity;
+		grid->cell_of = realloc(grid->cell_of, sizeof(int) * grid->capacity);
+		grid->indicies = realloc(grid->indicies, sizeof(int) * grid->capacity);
+	}
 
-	for(int r = 0; r < ROW; r++, current_position = (Vector2){(border_center.x - BORDER_RADIUS), (current_position.y + CSIZE)})
-		for(int c = 0; c < COL; c++, current_position.x += CSIZE)
+	// only the cells used last build need clearing
+	{
+		PROFILE_SCOPE(PROFILE_GRID_CLEAR);
+
+		for(int o = 0; o < grid->occupied_count; o++)
 		{
-			Cell cell;
-			cell.start = current_position;
-			cell.index_list.size = 0;
-			cell.index_list.capacity = sizeof(int);
-			cell.index_list.indicies = malloc(cell.index_list.capacity);
+			grid->cell_count[grid->occupied[o]] = 0;
+			grid->cell_awake[grid->occupied[o]] = 0;
+		}
+	}
+
+	PROFILE_SCOPE(PROFILE_GRID_INSERT);
+
+	grid->occupied_count = 0;
+	grid->circle_count = circles->size;
+	grid->layout = circles->layout;
+
+	// first pass, count circles per cell
+	for(int i = 0; i < circles->size; i++)
+	{
+		int c = floorf((circles->x[i] - grid->start.x) / grid->cell_size);
+		int r = floorf((circles->y[i] - grid->start.y) / grid->cell_size);
 
-			grid[r][c] = cell;
+		if((r < 0) || (r >= grid->rows) || (c < 0) || (c >= grid->cols))
+		{
+			grid->cell_of[i] = -1;
+			continue;
 		}
+
+		int cell = (r * grid->cols) + c;
+
+		grid->cell_count[cell]++;
+		grid->cell_awake[cell] += (circles->status[i] == FREE);
+
+		grid->cell_of[i] = cell;
+	}
+
+	// occupied cells come out in cell order from a scan of the counts, cheaper than sorting them for any grid the world fits
+	int offset = 0, cells = grid->rows * grid->cols;
+	memset(grid->group_start, 0, sizeof(int) * (CELL_GROUPS + 1));
+
+	for(int cell = 0; cell < cells; cell++)
+		if(grid->cell_count[cell] > 0)
+		{
+			grid->occupied[grid->occupied_count++] = cell;
+			grid->cell_start[cell] = offset;
+			offset += grid->cell_count[cell];
+			grid->group_start[cell_group(grid, cell) + 1]++;
+		}
+
+	for(int g = 0; g < CELL_GROUPS; g++)
+		grid->group_start[g + 1] += grid->group_start[g];
+
+	// second pass, scatter circles into their cell's run. cell_start is used as a cursor and restored after
+	for(int i = 0; i < circles->size; i++)
+		if(grid->cell_of[i] != -1)
+			grid->indicies[grid->cell_start[grid->cell_of[i]]++] = i;
+
+	for(int o = 0; o < grid->occupied_count; o++)
+	{
+		int cell = grid->occupied[o];
+		grid->cell_start[cell] -= grid->cell_count[cell];
+	}
+
+	int group_cursor[CELL_GROUPS];
+	memcpy(group_cursor, grid->group_start, sizeof(group_cursor));
+
+	for(int o = 0; o < grid->occupied_count; o++)
+		grid->group_cells[group_cursor[cell_group(grid, grid->occupied[o])]++] = grid->occupied[o];
 }
 
-void add_circle_to_grid(Grid grid[ROW][COL], int c_index, Vector2 position)
+// true when no circle in the cell or its half stencil can move, so none of its pairs need testing
+static bool stencil_asleep(Grid* grid, int cell)
 {
-	int c = ((position.x - grid[0][0].start.x) / CSIZE);
-	int r = ((position.y - grid[0][0].start.y) / CSIZE);
-	
-	if((r < ROW) && (c < COL)) 
-		add_circle_index(&grid[r][c].index_list, c_index);
+	int rows = grid->rows, cols = grid->cols;
+	int r = cell / cols, c = cell % cols;
+
+	if(grid->cell_awake[cell] || (((c + 1) < cols) && grid->cell_awake[cell + 1]))
+		return false;
+
+	if((r + 1) < rows)
+		for(int below = ((c > 0) ? (c - 1) : c); below <= (((c + 1) < cols) ? (c + 1) : c); below++)
+			if(grid->cell_awake[((r + 1) * cols) + below])
+				return false;
+
+	return true;
 }
 
-void clear_grid_index_lists(Grid grid[ROW][COL])
+// the half stencil of a cell as runs of indicies, as occupied cells are laid out in cell order. the rest of the cell
+// and the cell to the right are one run, ending at right_end, and the three cells below are another, from the first
+// occupied of them to the last. below_begin equals below_end when none is
+void grid_stencil_runs(Grid* grid, int cell, int* right_end, int* below_begin, int* below_end)
 {
-	for(int r = 0; r < ROW; r++) 
-		for(int c = 0; c < COL; c++) 
-			grid[r][c].index_list.size = 0;
+	int rows = grid->rows, cols = grid->cols;
+	int r = cell / cols, c = cell % cols;
+
+	*right_end = grid->cell_start[cell] + grid->cell_count[cell];
+
+	if((c + 1) < cols && grid->cell_count[cell + 1])
+		*right_end = grid->cell_start[cell + 1] + grid->cell_count[cell + 1];
+
+	*below_begin = *below_end = 0;
+
+	if((r + 1) < rows)
+	{
+		int first = (r + 1) * cols + ((c > 0) ? (c - 1) : c);
+		int last = (r + 1) * cols + (((c + 1) < cols) ? (c + 1) : c);
+
+		while((first <= last) && (grid->cell_count[first] == 0)) first++;
+		while((last >= first) && (grid->cell_count[last] == 0)) last--;
+
+		if(first <= last)
+		{
+			*below_begin = grid->cell_start[first];
+			*below_end = grid->cell_start[last] + grid->cell_count[last];
+		}
+	}
 }
 
-void grid_circle_collision(Grid grid[ROW][COL], Circles* circles)
+static void collide_cell(Grid* grid, Circles* circles, int cell)
 {
-	for (int r = 0; r < ROW; r++)
-		for (int c = 0; c < COL; c++)
+	if(stencil_asleep(grid, cell))
+		return;
+
+	int begin = grid->cell_start[cell];
+	int end = begin + grid->cell_count[cell];
+	int right_end, below_begin, below_end;
+
+	grid_stencil_runs(grid, cell, &right_end, &below_begin, &below_end);
+
+	for(int k = begin; k < end; k++)
+	{
+		handle_verlet_circle_batch(circles, grid->indicies[k], (grid->indicies + k + 1), (right_end - k - 1));
+		handle_verlet_circle_batch(circles, grid->indicies[k], (grid->indicies + below_begin), (below_end - below_begin));
+	}
+}
+
+// visits the circles binned in every cell overlapping the box from low to high, as of the last build
+void grid_query(Grid* grid, Vector2 low, Vector2 high, CircleVisitor visit, void* context)
+{
+	int first_col = fmaxf(floorf((low.x - grid->start.x) / grid->cell_size), 0);
+	int first_row = fmaxf(floorf((low.y - grid->start.y) / grid->cell_size), 0);
+	int last_col = fminf(floorf((high.x - grid->start.x) / grid->cell_size), (grid->cols - 1));
+	int last_row = fminf(floorf((high.y - grid->start.y) / grid->cell_size), (grid->rows - 1));
+
+	for(int r = first_row; r <= last_row; r++)
+		for(int c = first_col; c <= last_col; c++)
 		{
-			// same cell circle coll.
-			IndexList* il = &grid[r][c].index_list;
-
-			for (int i = 0; i < il->size; i++) 
-				for (int j = i + 1; j < il->size; j++) 
-					handle_verlet_circle_collision(&circles->circle[il->indicies[i]], &circles->circle[il->indicies[j]]);
-
-			// neighbor cell circle collisions
-			for (int dx = -1; dx <= 1; dx++)
-				for (int dy = -1; dy <= 1; dy++)
-				{
-					int nr = r + dx;
-					int nc = c + dy;
-					IndexList* nil = &grid[nr][nc].index_list;
-					// out of bounds case
-					if ((nr < 0 || nr >= ROW) || (nc < 0 || nc >= ROW) || (nr == r && nc == c)) continue;
-					
-					for (int i = 0; i < il->size; i++)
-						for (int j = 0; j < nil->size; j++)
-							handle_verlet_circle_collision(&circles->circle[il->indicies[i]], &circles->circle[nil->indicies[j]]);
-				}
+			int cell = (r * grid->cols) + c;
+
+			for(int k = 0; k < grid->cell_count[cell]; k++)
+				visit(context, grid->indicies[grid->cell_start[cell] + k]);
 		}
 }
 
-void dealloc_grid(Grid grid[ROW][COL])
+int grid_group_size(Grid* grid, int group)
 {
-	for(int r = 0; r < ROW; r++) 
-		for(int c = 0; c < COL; c++)
-			free(grid[r][c].index_list.indicies);
-}
\ No newline at end of file
+	return grid->group_start[group + 1] - grid->group_start[group];
+}
+
+// cells [begin, end) of one group, which may run alongside any other cells of the same group. with the groups run one
+// after another the outcome is the same for any worker count
+void grid_collide_group(Grid* grid, Circles* circles, int group, int begin, int end)
+{
+	int* cells = grid->group_cells + grid->group_start[group];
+
+	for(int i = begin; i < end; i++)
+		collide_cell(grid, circles, cells[i]);
+}
+
+void dealloc_grid(Grid* grid)
+{
+	free(grid->cell_count);
+	free(grid->cell_awake);
+	free(grid->cell_start);
+	free(grid->occupied);
+	free(grid->group_start);
+	free(grid->group_cells);
+	free(grid->cell_of);
+	free(grid->indicies);
+}
@@ -0,0 +1,401 @@
+#include "headers/thread_pool.h"
+#include "headers/profile.h"
+#include "headers/perf_counters.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// jobs a task is split into per thread, more than one so uneven jobs even out through stealing
+#define CHUNKS_PER_THREAD 4
+
+// only called between runs, while every deque is empty
+static void reserve_deque(JobDeque* deque, long capacity)
+{
+	if(capacity <= deque->capacity)
+		return;
+
+	long grown = (deque->capacity > 0) ? deque->capacity : 64;
+
+	while(grown < capacity)
+		grown *= 2;
+
+	free(deque->buffer);
+	deque->buffer = malloc(grown * sizeof(_Atomic(Job*)));
+	deque->capacity = grown;
+	atomic_store(&deque->top, 0);
+	atomic_store(&deque->bottom, 0);
+}
+
+// every operation is sequentially consistent, which stands in for the fences of the original algorithm
+static void push_job(JobDeque* deque, Job* job)
+{
+	long b = atomic_load(&deque->bottom);
+
+	atomic_store(&deque->buffer[b & (deque->capacity - 1)], job);
+	atomic_store(&deque->bottom, b + 1);
+}
+
+static Job* pop_job(JobDeque* deque)
+{
+	long b = atomic_load(&deque->bottom) - 1;
+	atomic_store(&deque->bottom, b);
+	long t = atomic_load(&deque->top);
+
+	if(t > b)
+	{
+		atomic_store(&deque->bottom, b + 1);
+		return NULL;
+	}
+
+	Job* job = atomic_load(&deque->buffer[b & (deque->capacity - 1)]);
+
+	// the last job, which a thief may be taking at the same time
+	if(t == b)
+	{
+		if(!atomic_compare_exchange_strong(&deque->top, &t, t + 1))
+			job = NULL;
+
+		atomic_store(&deque->bottom, b + 1);
+	}
+
+	return job;
+}
+
+static Job* steal_job(JobDeque* deque)
+{
+	long t = atomic_load(&deque->top);
+	long b = atomic_load(&deque->bottom);
+
+	if(t >= b)
+		return NULL;
+
+	Job* job = atomic_load(&deque->buffer[t & (deque->capacity - 1)]);
+
+	if(!atomic_compare_exchange_strong(&deque->top, &t, t + 1))
+		return NULL;
+
+	return job;
+}
+
+static void release_task(ThreadPool* pool, TaskGraph* graph, int self, int t);
+
+static void finish_task(ThreadPool* pool, TaskGraph* graph, int self, int t)
+{
+	Task* task = &graph->tasks[t];
+
+	for(int d = 0; d < task->dependent_count; d++)
+		if(atomic_fetch_sub(&graph->tasks[task->dependents[d]].unmet, 1) == 1)
+			release_task(pool, graph, self, task->dependents[d]);
+
+	// dependents are released first, so the graph never looks done while they are still to run
+	atomic_fetch_sub(&graph->remaining, 1);
+}
+
+// splits a task whose dependencies are all done into jobs on the releasing thread's deque
+static void release_task(ThreadPool* pool, TaskGraph* graph, int self, int t)
+{
+	Task* task = &graph->tasks[t];
+	int begin = task->begin, end = (task->count != NULL) ? task->count(task->context) : task->end;
+
+	if(begin >= end)
+	{
+		finish_task(pool, graph, self, t);
+		return;
+	}
+
+	int chunks = task->serial ? 1 : (pool->thread_count * CHUNKS_PER_THREAD);
+
+	if(chunks > (end - begin))
+		chunks = end - begin;
+
+	atomic_store(&task->pending, chunks);
+	int first = atomic_fetch_add(&graph->job_cursor, chunks);
+
+	for(int c = 0; c < chunks; c++)
+	{
+		Job* job = &graph->jobs[first + c];
+
+		job->task = t;
+		job->begin = begin + (int)(((long)(end - begin) * c) / chunks);
+		job->end = begin + (int)(((long)(end - begin) * (c + 1)) / chunks);
+		push_job(&pool->deques[self], job);
+	}
+}
+
+static Job* find_job(ThreadPool* pool, int self)
+{
+	Job* job = pop_job(&pool->deques[self]);
+
+	for(int k = 1; (job == NULL) && (k < pool->thread_count); k++)
+		job = steal_job(&pool->deques[(self + k) % pool->thread_count]);
+
+	return job;
+}
+
+static void work(ThreadPool* pool, TaskGraph* graph, int self)
+{
+	while(atomic_load(&graph->remaining) > 0)
+	{
+		Job* job = find_job(pool, self);
+
+		if(job == NULL)
+		{
+			sched_yield();
+			continue;
+		}
+
+		Task* task = &graph->tasks[job->task];
+		task->function(task->context, job->begin, job->end);
+
+		if(atomic_fetch_sub(&task->pending, 1) == 1)
+			finish_task(pool, graph, self, job->task);
+	}
+}
+
+static void* worker_main(void* arg)
+{
+	ThreadPool* pool = arg;
+	int self = atomic_fetch_add(&pool->started, 1);
+	int seen = 0;
+	char name[32];
+
+	snprintf(name, sizeof(name), "worker %d", self);
+	profile_name_thread(name);
+
+	pthread_mutex_lock(&pool->lock);
+
+	for(;;)
+	{
+		while(!pool->shutdown && (pool->generation == seen))
+			pthread_cond_wait(&pool->work_ready, &pool->lock);
+
+		if(pool->shutdown)
+			break;
+
+		seen = pool->generation;
+		TaskGraph* graph = pool->graph;
+		pthread_mutex_unlock(&pool->lock);
+
+		work(pool, graph, self);
+
+		pthread_mutex_lock(&pool->lock);
+
+		if(--pool->active == 0)
+			pthread_cond_signal(&pool->work_done);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+	profile_release_thread();
+	close_counters();
+	return NULL;
+}
+
+ThreadPool* create_thread_pool(int thread_count)
+{
+	ThreadPool* pool = malloc(sizeof(ThreadPool));
+
+	pool->thread_count = (thread_count > 1) ? thread_count : 1;
+	pool->workers = malloc(sizeof(pthread_t) * pool->thread_count);
+	pool->deques = calloc(pool->thread_count, sizeof(JobDeque));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_ready, NULL);
+	pthread_cond_init(&pool->work_done, NULL);
+	pool->generation = 0;
+	pool->active = 0;
+	pool->shutdown = false;
+	pool->graph = NULL;
+	pool->range_graph = create_task_graph();
+
+	// the calling thread is the first worker
+	atomic_init(&pool->started, 1);
+
+	for(int i = 1; i < pool->thread_count; i++)
+		pthread_create(&pool->workers[i], NULL, worker_main, pool);
+
+	return pool;
+}
+
+// not to be called from inside a task, the pool runs one graph at a time
+void parallel_for(ThreadPool* pool, int begin, int end, RangeFunction function, void* context)
+{
+	if(begin >= end)
+		return;
+
+	if((pool == NULL) || (pool->thread_count == 1))
+	{
+		function(context, begin, end);
+		return;
+	}
+
+	clear_task_graph(&pool->range_graph);
+	add_task(&pool->range_graph, function, context, begin, end);
+	run_task_graph(pool, &pool->range_graph);
+}
+
+void dealloc_thread_pool(ThreadPool* pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = true;
+	pthread_cond_broadcast(&pool->work_ready);
+	pthread_mutex_unlock(&pool->lock);
+
+	for(int i = 1; i < pool->thread_count; i++)
+		pthread_join(pool->workers[i], NULL);
+
+	for(int i = 0; i < pool->thread_count; i++)
+		free(pool->deques[i].buffer);
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work_ready);
+	pthread_cond_destroy(&pool->work_done);
+	dealloc_task_graph(&pool->range_graph);
+	free(pool->deques);
+	free(pool->workers);
+	free(pool);
+}
+
+TaskGraph create_task_graph()
+{
+	TaskGraph graph;
+
+	graph.tasks = NULL;
+	graph.task_count = 0;
+	graph.task_capacity = 0;
+	graph.jobs = NULL;
+	atomic_init(&graph.job_cursor, 0);
+	graph.job_capacity = 0;
+	atomic_init(&graph.remaining, 0);
+
+	return graph;
+}
+
+void clear_task_graph(TaskGraph* graph)
+{
+	graph->task_count = 0;
+}
+
+int add_task(TaskGraph* graph, RangeFunction function, void* context, int begin, int end)
+{
+	if(graph->task_count == graph->task_capacity)
+	{
+		int capacity = (graph->task_capacity > 0) ? (graph->task_capacity * 2) : 16;
+
+		graph->tasks = realloc(graph->tasks, capacity * sizeof(Task));
+
+		for(int t = graph->task_capacity; t < capacity; t++)
+		{
+			graph->tasks[t].dependents = NULL;
+			graph->tasks[t].dependent_capacity = 0;
+		}
+
+		graph->task_capacity = capacity;
+	}
+
+	Task* task = &graph->tasks[graph->task_count];
+
+	task->function = function;
+	task->count = NULL;
+	task->context = context;
+	task->begin = begin;
+	task->end = end;
+	task->serial = false;
+	task->dependencies = 0;
+	task->dependent_count = 0;
+
+	return graph->task_count++;
+}
+
+int add_counted_task(TaskGraph* graph, RangeFunction function, RangeCount count, void* context)
+{
+	int t = add_task(graph, function, context, 0, 0);
+
+	graph->tasks[t].count = count;
+	return t;
+}
+
+// before has to have been added first
+void add_dependency(TaskGraph* graph, int before, int after)
+{
+	Task* task = &graph->tasks[before];
+
+	if(task->dependent_count == task->dependent_capacity)
+	{
+		task->dependent_capacity = (task->dependent_capacity > 0) ? (task->dependent_capacity * 2) : 2;
+		task->dependents = realloc(task->dependents, task->dependent_capacity * sizeof(int));
+	}
+
+	task->dependents[task->dependent_count++] = after;
+	graph->tasks[after].dependencies++;
+}
+
+// a lone thread runs the tasks in the order they were added, each as one range. tasks split into jobs that never
+// touch the same data, so either way gives the same result
+void run_task_graph(ThreadPool* pool, TaskGraph* graph)
+{
+	if(graph->task_count == 0)
+		return;
+
+	if((pool == NULL) || (pool->thread_count == 1))
+	{
+		for(int t = 0; t < graph->task_count; t++)
+		{
+			Task* task = &graph->tasks[t];
+			int end = (task->count != NULL) ? task->count(task->context) : task->end;
+
+			if(task->begin < end)
+				task->function(task->context, task->begin, end);
+		}
+
+		return;
+	}
+
+	int job_capacity = graph->task_count * pool->thread_count * CHUNKS_PER_THREAD;
+
+	if(job_capacity > graph->job_capacity)
+	{
+		graph->jobs = realloc(graph->jobs, job_capacity * sizeof(Job));
+		graph->job_capacity = job_capacity;
+	}
+
+	for(int i = 0; i < pool->thread_count; i++)
+		reserve_deque(&pool->deques[i], job_capacity);
+
+	for(int t = 0; t < graph->task_count; t++)
+	{
+		atomic_store(&graph->tasks[t].unmet, graph->tasks[t].dependencies);
+		atomic_store(&graph->tasks[t].pending, 0);
+	}
+
+	atomic_store(&graph->job_cursor, 0);
+	atomic_store(&graph->remaining, graph->task_count);
+
+	pthread_mutex_lock(&pool->lock);
+	pool->graph = graph;
+	pool->active = pool->thread_count - 1;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->work_ready);
+	pthread_mutex_unlock(&pool->lock);
+
+	for(int t = 0; t < graph->task_count; t++)
+		if(graph->tasks[t].dependencies == 0)
+			release_task(pool, graph, 0, t);
+
+	work(pool, graph, 0);
+
+	pthread_mutex_lock(&pool->lock);
+
+	while(pool->active > 0)
+		pthread_cond_wait(&pool->work_done, &pool->lock);
+
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void dealloc_task_graph(TaskGraph* graph)
+{
+	for(int t = 0; t < graph->task_capacity; t++)
+		free(graph->tasks[t].dependents);
+
+	free(graph->tasks);
+	free(graph->jobs);
+	*graph = create_task_graph();
+}
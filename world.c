@@ -0,0 +1,815 @@
+#include "headers/world.h"
+#include "headers/physics.h"
+#include "headers/profile.h"
+#include <float.h>
+#include <string.h>
+
+// where a phase started, in time and, when the world is counting, in hardware counters
+typedef struct
+{
+	long long start;
+	CounterSample counters;
+	bool counted;
+} PhaseMark;
+
+static PhaseMark begin_phase(VerletWorld* world)
+{
+	PhaseMark mark;
+
+	mark.counted = world->counting && read_counters(&mark.counters);
+	mark.start = profile_now();
+
+	return mark;
+}
+
+static void end_phase(VerletWorld* world, StepPhase phase, PhaseMark* mark)
+{
+	CounterSample end;
+
+	atomic_fetch_add_explicit(&world->stats.phase_ns[phase], (profile_now() - mark->start), memory_order_relaxed);
+
+	if(!mark->counted || !read_counters(&end))
+		return;
+
+	for(int k = 0; k < COUNTER_COUNT; k++)
+		if((end.values[k] >= 0) && (mark->counters.values[k] >= 0))
+		{
+			atomic_fetch_add_explicit(&world->stats.counters[phase][k], (end.values[k] - mark->counters.values[k]), memory_order_relaxed);
+			atomic_fetch_or_explicit(&world->stats.counted, (1 << k), memory_order_relaxed);
+		}
+}
+
+VerletWorld create_world()
+{
+	VerletWorld world;
+
+	world.circles = create_circles();
+	world.chain = create_chain();
+	world.broadphase = DENSE_GRID;
+	world.grid = NULL;
+	world.hash = NULL;
+	world.neighbors = NULL;
+	world.neighbor_skin = 4.0f;
+	world.counting = false;
+	world.sleeping = false;
+	world.slept = false;
+
+	world.collide = false;
+	world.reorder_interval = 0;
+	world.steps_since_reorder = 0;
+	world.steps = 0;
+	world.substep = 0;
+	world.substep_start = 0;
+	reset_world_stats(&world);
+	world.worker_count = 1;
+	world.pool = NULL;
+	world.step_graph = create_task_graph();
+	world.bounded = false;
+	world.border_center = (Vector2){ 0 };
+	world.border_radius = 400.0f;
+
+	world.gravity = (Vector2){ 0, 1000.0f };
+	world.slept_gravity = world.gravity;
+	world.damping = 0.995f;
+	world.link_iterations = 1;
+	world.max_link_distance = 100.0f;
+	world.cut_radius = 5.0f;
+
+	world.input = (VerletInput){ .cursor = { 0 }, .cut = false, .grabbed = NO_CIRCLE };
+
+	world.fixed_dt = 1.0f / 60.0f;
+	world.max_frame_steps = 4;
+	world.accumulator = 0;
+	world.alpha = 0;
+	world.step_start_x = world.step_start_y = NULL;
+	world.step_start_size = 0;
+	world.step_start_layout = 0;
+	world.draw_x = world.draw_y = NULL;
+	world.draw_capacity = 0;
+
+	return world;
+}
+
+typedef struct
+{
+	VerletWorld* world;
+	int* links;
+	atomic_int torn;
+} LinkGroup;
+
+static void solve_link_range(void* context, int begin, int end)
+{
+	LinkGroup* group = context;
+	VerletWorld* world = group->world;
+	Chain* chain = &world->chain;
+	Circles* circles = &world->circles;
+	PhaseMark mark = begin_phase(world);
+	int torn = 0;
+
+	PROFILE_SCOPE(PROFILE_LINKS);
+
+	for(int k = begin; k < end; k++)
+	{
+		int l = group->links[k];
+
+		if(!chain->alive[l])
+			continue;
+
+		int i = chain->circle1[l], j = chain->circle2[l];
+		Vector2 starting_position = { circles->x[i], circles->y[i] }, 
+				ending_position = { circles->x[j], circles->y[j] };
+
+		// torn links are counted here and taken off alive_count once the step is done, other threads share it
+		if((Vector2Distance(starting_position, ending_position) >= world->max_link_distance) || (world->input.cut && point_near_segment(world->input.cursor, starting_position, ending_position, world->cut_radius)))
+		{
+			chain->alive[l] = 0;
+			torn++;
+			continue;
+		}
+
+		maintain_link(circles, i, j, chain->target_distance[l]);
+	}
+
+	atomic_fetch_add(&group->torn, torn);
+	end_phase(world, PHASE_LINKS, &mark);
+}
+
+typedef struct
+{
+	VerletWorld* world;
+	float dt;
+} Integration;
+
+static void integrate_range(void* context, int begin, int end)
+{
+	Integration* integration = context;
+	VerletWorld* world = integration->world;
+	Circles* circles = &world->circles;
+	PhaseMark mark = begin_phase(world);
+
+	// each circle is integrated and kept inside the border on its own, so the border needs no task of its own.
+	// the range is small enough to still be in cache for the second pass
+	{
+		PROFILE_SCOPE(PROFILE_INTEGRATE);
+
+		for(int i = begin; i < end; i++)
+		{
+			// a sleeping circle costs a border check, in case the border shrank onto it
+			if(circles->status[i] == SLEEPING)
+			{
+				if(world->bounded && outside_border(circles, i, world->border_center, world->border_radius))
+					wake_circle(circles, i);
+				else
+					continue;
+			}
+
+			if(circles->status[i] == FREE)
+			{
+				update_position(circles, i, world->damping, integration->dt);
+				apply_gravity(circles, i, world->gravity, integration->dt);
+
+				if(world->sleeping)
+					update_rest(circles, i);
+			}
+		}
+	}
+
+	if(world->bounded)
+	{
+		PROFILE_SCOPE(PROFILE_BORDER);
+
+		// circles that fell asleep this substep still need pushing back in, the rest sit inside and are left alone
+		for(int i = begin; i < end; i++)
+			handle_border_collision(circles, i, world->border_center, world->gravity, world->border_radius);
+	}
+
+	end_phase(world, PHASE_INTEGRATE, &mark);
+}
+
+// the grid is built from the integrated positions, a cell one diameter wide has no slack for circles that move after binning
+static void build_broadphase(void* context, int begin, int end)
+{
+	VerletWorld* world = context;
+	PhaseMark mark = begin_phase(world);
+
+	if(world->broadphase == HASHED_GRID)
+		build_spatial_hash(world->hash, &world->circles);
+	else if(world->broadphase == NEIGHBOR_LIST)
+	{
+		world->neighbors->skin = world->neighbor_skin;
+
+		if(neighbor_list_stale(world->neighbors, &world->circles))
+		{
+			build_grid(world->grid, &world->circles);
+			build_neighbor_list(world->neighbors, world->grid, &world->circles);
+		}
+	}
+	else
+		build_grid(world->grid, &world->circles);
+
+	end_phase(world, PHASE_BROADPHASE, &mark);
+}
+
+typedef struct
+{
+	VerletWorld* world;
+	int group;
+} CollisionGroup;
+
+static int collision_group_size(void* context)
+{
+	CollisionGroup* collision = context;
+	VerletWorld* world = collision->world;
+
+	if(world->broadphase == HASHED_GRID)
+		return hash_group_size(world->hash, collision->group);
+	else if(world->broadphase == NEIGHBOR_LIST)
+		return neighbor_group_size(world->neighbors, collision->group);
+
+	return grid_group_size(world->grid, collision->group);
+}
+
+static void collide_group_range(void* context, int begin, int end)
+{
+	CollisionGroup* collision = context;
+	VerletWorld* world = collision->world;
+	PhaseMark mark = begin_phase(world);
+
+	PROFILE_SCOPE(PROFILE_NARROWPHASE);
+
+	if(world->broadphase == HASHED_GRID)
+		hash_collide_group(world->hash, &world->circles, collision->group, begin, end);
+	else if(world->broadphase == NEIGHBOR_LIST)
+		neighbor_collide_group(world->neighbors, &world->circles, collision->group, begin, end);
+	else
+		grid_collide_group(world->grid, &world->circles, collision->group, begin, end);
+
+	end_phase(world, PHASE_COLLIDE, &mark);
+}
+
+// a substep's span for traces, from just before its integration to just after its last link solve
+static void begin_substep(void* context, int begin, int end)
+{
+	VerletWorld* world = context;
+	world->substep_start = profile_now();
+}
+
+static void end_substep(void* context, int begin, int end)
+{
+	VerletWorld* world = context;
+	profile_record_step(PROFILE_SUBSTEP, world->substep_start, profile_now(), world->steps, world->substep++);
+}
+
+// one step as a graph: per substep integrate, build the broadphase, collide each cell group in turn, then solve each
+// link color link_iterations times. every task reads what the one before it wrote, so the graph is a chain and the
+// parallelism is within tasks, but the workers carry on from task to task and substep to substep without a barrier
+// between them. groups and colors keep their order, so the outcome is the same for any worker count
+static void build_step_graph(VerletWorld* world, TaskGraph* graph, Integration* integration, CollisionGroup* collisions, LinkGroup* links, int substeps)
+{
+	Chain* chain = &world->chain;
+	bool colliding = world->collide && ((world->broadphase == HASHED_GRID) ? (world->hash != NULL) : (world->grid != NULL));
+	bool marking = false;
+	int last = -1;
+
+#ifdef VERLET_PROFILE
+	marking = profile_tracing();
+#endif
+
+	clear_task_graph(graph);
+
+	for(int s = 0; s < substeps; s++)
+	{
+		int task;
+
+		if(marking)
+		{
+			task = add_task(graph, begin_substep, world, 0, 1);
+
+			if(last != -1)
+				add_dependency(graph, last, task);
+
+			last = task;
+		}
+
+		task = add_task(graph, integrate_range, integration, 0, world->circles.size);
+
+		if(last != -1)
+			add_dependency(graph, last, task);
+
+		last = task;
+
+		if(colliding)
+		{
+			task = add_task(graph, build_broadphase, world, 0, 1);
+			add_dependency(graph, last, task);
+			last = task;
+
+			for(int g = 0; g < CELL_GROUPS; g++)
+			{
+				task = add_counted_task(graph, collide_group_range, collision_group_size, &collisions[g]);
+				add_dependency(graph, last, task);
+				last = task;
+			}
+		}
+
+		for(int i = 0; i < world->link_iterations; i++)
+			for(int c = 0; c < chain->color_count; c++)
+			{
+				int count = chain->color_start[c + 1] - chain->color_start[c];
+
+				if(count == 0)
+					continue;
+
+				task = add_task(graph, solve_link_range, &links[c], 0, count);
+				graph->tasks[task].serial = (c == (LINK_COLORS - 1));
+				add_dependency(graph, last, task);
+				last = task;
+			}
+
+		if(marking)
+		{
+			task = add_task(graph, end_substep, world, 0, 1);
+			add_dependency(graph, last, task);
+			last = task;
+		}
+	}
+}
+
+// sizes the grid cells to the largest circle diameter and the grid to the world bounds, rebuilding only when either changed
+static void fit_grid(VerletWorld* world)
+{
+	Circles* circles = &world->circles;
+	float max_radius = 0;
+	Vector2 low = { FLT_MAX, FLT_MAX }, high = { -FLT_MAX, -FLT_MAX };
+
+	if(circles->size == 0)
+		return;
+
+	for(int i = 0; i < circles->size; i++)
+		max_radius = fmaxf(max_radius, circles->radius[i]);
+
+	// the hash is rebuilt every substep anyway, only its cell size needs keeping up
+	if(world->broadphase == HASHED_GRID)
+	{
+		if(world->hash == NULL)
+		{
+			world->hash = malloc(sizeof(SpatialHash));
+			*world->hash = create_spatial_hash(2 * max_radius);
+		}
+
+		world->hash->cell_size = 2 * max_radius;
+		return;
+	}
+
+	if(!world->bounded)
+		for(int i = 0; i < circles->size; i++)
+		{
+			low = (Vector2){ fminf(low.x, circles->x[i]), fminf(low.y, circles->y[i]) };
+			high = (Vector2){ fmaxf(high.x, circles->x[i]), fmaxf(high.y, circles->y[i]) };
+		}
+
+	float cell_size = 2 * max_radius;
+	Vector2 start, extent;
+
+	// pairs are gathered out to the skin, which the cells have to span as well
+	if(world->broadphase == NEIGHBOR_LIST)
+	{
+		cell_size += world->neighbor_skin;
+
+		if(world->neighbors == NULL)
+		{
+			world->neighbors = malloc(sizeof(NeighborList));
+			*world->neighbors = create_neighbor_list(world->neighbor_skin);
+		}
+	}
+
+	// one cell of padding catches circles that overshoot the border within a substep
+	if(world->bounded)
+	{
+		start = Vector2SubtractValue(world->border_center, (world->border_radius + cell_size));
+		extent = (Vector2){ 2 * (world->border_radius + cell_size), 2 * (world->border_radius + cell_size) };
+	}
+	else
+	{
+		start = Vector2SubtractValue(low, cell_size);
+		extent = Vector2AddValue(Vector2Subtract(high, low), (2 * cell_size));
+	}
+
+	if(world->grid != NULL && (world->grid->cell_size == cell_size))
+	{
+		if(world->bounded && Vector2Equals(world->grid->start, start) && (world->grid->cols == (int)ceilf(extent.x / cell_size)))
+			return;
+
+		if(!world->bounded && grid_covers(world->grid, start, extent))
+			return;
+	}
+
+	// an open world grows with some slack, so a drifting cloud does not rebuild the grid every step
+	if(!world->bounded)
+	{
+		Vector2 margin = Vector2Scale(extent, 0.25f);
+		start = Vector2Subtract(start, margin);
+		extent = Vector2Add(extent, Vector2Scale(margin, 2));
+	}
+
+	if(world->grid == NULL)
+		world->grid = malloc(sizeof(Grid));
+	else
+		dealloc_grid(world->grid);
+
+	*world->grid = create_grid(start, extent, cell_size);
+}
+
+// sorts the circles by the z-order of their cell, so neighbors in space are neighbors in memory. links and input hold handles, which follow the moves
+static void reorder_circles(VerletWorld* world)
+{
+	Circles* circles = &world->circles;
+	Vector2 origin = { FLT_MAX, FLT_MAX };
+	float max_radius = 0;
+
+	if(circles->size == 0)
+		return;
+
+	for(int i = 0; i < circles->size; i++)
+	{
+		origin = (Vector2){ fminf(origin.x, circles->x[i]), fminf(origin.y, circles->y[i]) };
+		max_radius = fmaxf(max_radius, circles->radius[i]);
+	}
+
+	int* order = malloc(sizeof(int) * circles->size);
+
+	morton_order(circles, origin, fmaxf((2 * max_radius), 1), order);
+	permute_circles(circles, order);
+
+	free(order);
+}
+
+// visits the circles binned in the broadphase's cells overlapping the box, padded by a cell as circles sit at most one
+// cell past where they were binned. if circles moved to other indicies since the last build (an erase) the bins are
+// rebuilt first. returns how many circles the bins hold, the ones added after are not binned yet
+static int query_bins(VerletWorld* world, Vector2 low, Vector2 high, CircleVisitor visit, void* context)
+{
+	Circles* circles = &world->circles;
+
+	if(world->collide && (world->broadphase == HASHED_GRID) && (world->hash != NULL))
+	{
+		if(world->hash->layout != circles->layout)
+			build_spatial_hash(world->hash, circles);
+
+		float pad = world->hash->cell_size;
+		hash_query(world->hash, Vector2SubtractValue(low, pad), Vector2AddValue(high, pad), visit, context);
+
+		return world->hash->circle_count;
+	}
+
+	if(world->collide && (world->broadphase != HASHED_GRID) && (world->grid != NULL))
+	{
+		if(world->grid->layout != circles->layout)
+			build_grid(world->grid, circles);
+
+		float pad = world->grid->cell_size;
+		grid_query(world->grid, Vector2SubtractValue(low, pad), Vector2AddValue(high, pad), visit, context);
+
+		return world->grid->circle_count;
+	}
+
+	return 0;
+}
+
+typedef struct
+{
+	Circles* circles;
+	Vector2 gravity;
+	int mover;
+} SupportCheck;
+
+static void check_support(void* context, int circle)
+{
+	SupportCheck* check = context;
+	wake_on_support_loss(check->circles, circle, check->mover, check->gravity);
+}
+
+// sleepers resting on circles that are now falling away wake, and as they fall the ones on them wake a step later,
+// so a pile dug out from under comes down layer by layer. runs once a step, over the moving circles only
+static void wake_unsupported(VerletWorld* world)
+{
+	Circles* circles = &world->circles;
+	SupportCheck check = { circles, world->gravity, 0 };
+
+	for(int i = 0; i < circles->size; i++)
+		if((circles->status[i] == FREE) && circle_moving(circles, i))
+		{
+			Vector2 position = { circles->x[i], circles->y[i] };
+			float reach = 3 * circles->radius[i];
+
+			check.mover = i;
+			query_bins(world, Vector2SubtractValue(position, reach), Vector2AddValue(position, reach), check_support, &check);
+		}
+}
+
+// everything sleeping is woken when sleep is turned off or gravity changes, as resting under the old gravity says nothing about the new
+static void wake_all(VerletWorld* world)
+{
+	for(int i = 0; i < world->circles.size; i++)
+		if(world->circles.status[i] == SLEEPING)
+			wake_circle(&world->circles, i);
+}
+
+void world_step(VerletWorld* world, float dt, int substeps)
+{
+	long long step_start = profile_now();
+	PhaseMark setup = begin_phase(world);
+
+	world->steps++;
+	world->substep = 0;
+
+	if((world->sleeping != world->slept) || !Vector2Equals(world->gravity, world->slept_gravity))
+	{
+		wake_all(world);
+		world->slept = world->sleeping;
+		world->slept_gravity = world->gravity;
+	}
+
+	if((world->reorder_interval > 0) && (++world->steps_since_reorder >= world->reorder_interval))
+	{
+		reorder_circles(world);
+		world->steps_since_reorder = 0;
+	}
+
+	if(world->collide)
+		fit_grid(world);
+
+	if((world->worker_count > 1) && ((world->pool == NULL) || (world->pool->thread_count != world->worker_count)))
+	{
+		if(world->pool != NULL)
+			dealloc_thread_pool(world->pool);
+
+		world->pool = create_thread_pool(world->worker_count);
+	}
+
+	sync_chain(&world->chain, &world->circles);
+
+	if((world->chain.colored_size != world->chain.size) || (world->chain.colored_compactions != world->chain.compactions))
+		color_chain(&world->chain, world->circles.size);
+
+	Integration integration = { world, (dt / substeps) };
+	CollisionGroup collisions[CELL_GROUPS];
+	LinkGroup links[LINK_COLORS];
+
+	for(int g = 0; g < CELL_GROUPS; g++)
+		collisions[g] = (CollisionGroup){ world, g };
+
+	for(int c = 0; c < world->chain.color_count; c++)
+	{
+		links[c].world = world;
+		links[c].links = world->chain.colored + world->chain.color_start[c];
+		atomic_init(&links[c].torn, 0);
+	}
+
+	build_step_graph(world, &world->step_graph, &integration, collisions, links, substeps);
+	end_phase(world, PHASE_SETUP, &setup);
+
+	run_task_graph((world->worker_count > 1) ? world->pool : NULL, &world->step_graph);
+
+	PhaseMark finish = begin_phase(world);
+
+	for(int c = 0; c < world->chain.color_count; c++)
+		world->chain.alive_count -= atomic_load(&links[c].torn);
+
+	// once most links are torn, dropping them is cheaper than skipping them every solve
+	if((world->chain.size > 64) && (world->chain.alive_count < (world->chain.size / 2)))
+		compact_chain(&world->chain);
+
+	end_phase(world, PHASE_SETUP, &finish);
+
+	if(world->sleeping && world->collide)
+	{
+		PhaseMark support = begin_phase(world);
+		wake_unsupported(world);
+		end_phase(world, PHASE_COLLIDE, &support);
+	}
+
+	finish = begin_phase(world);
+
+	int grabbed = circle_index(&world->circles, world->input.grabbed);
+
+	if(grabbed != -1)
+	{
+		world->circles.x[grabbed] = world->input.cursor.x;
+		world->circles.y[grabbed] = world->input.cursor.y;
+	}
+
+	end_phase(world, PHASE_SETUP, &finish);
+	world->stats.step_ns += profile_now() - step_start;
+	world->stats.circle_substeps += (long long)world->circles.size * substeps;
+	world->stats.steps++;
+
+#ifdef VERLET_PROFILE
+	profile_record_step(PROFILE_STEP, step_start, profile_now(), world->steps, -1);
+#endif
+}
+
+static void reserve_draw_buffers(VerletWorld* world)
+{
+	Circles* circles = &world->circles;
+
+	if(circles->size > world->draw_capacity)
+	{
+		world->draw_capacity = circles->capacity;
+		world->step_start_x = realloc(world->step_start_x, world->draw_capacity * sizeof(float));
+		world->step_start_y = realloc(world->step_start_y, world->draw_capacity * sizeof(float));
+		world->draw_x = realloc(world->draw_x, world->draw_capacity * sizeof(float));
+		world->draw_y = realloc(world->draw_y, world->draw_capacity * sizeof(float));
+	}
+}
+
+// positions at the start of the step, what the drawn positions are blended from
+static void snapshot_step_start(VerletWorld* world)
+{
+	Circles* circles = &world->circles;
+
+	reserve_draw_buffers(world);
+
+	world->step_start_size = circles->size;
+	world->step_start_layout = circles->layout;
+
+	if(circles->size == 0)
+		return;
+
+	memcpy(world->step_start_x, circles->x, circles->size * sizeof(float));
+	memcpy(world->step_start_y, circles->y, circles->size * sizeof(float));
+}
+
+// fills draw_x and draw_y. circles added since the snapshot, or every circle after the store was reshuffled, are drawn where they are
+void world_interpolate(VerletWorld* world)
+{
+	Circles* circles = &world->circles;
+	int blended = (circles->layout == world->step_start_layout) ? world->step_start_size : 0;
+
+	reserve_draw_buffers(world);
+
+	if(circles->size == 0)
+		return;
+
+	if(blended > circles->size)
+		blended = circles->size;
+
+	for(int i = 0; i < blended; i++)
+	{
+		world->draw_x[i] = world->step_start_x[i] + (circles->x[i] - world->step_start_x[i]) * world->alpha;
+		world->draw_y[i] = world->step_start_y[i] + (circles->y[i] - world->step_start_y[i]) * world->alpha;
+	}
+
+	memcpy(world->draw_x + blended, circles->x + blended, (circles->size - blended) * sizeof(float));
+	memcpy(world->draw_y + blended, circles->y + blended, (circles->size - blended) * sizeof(float));
+}
+
+// runs the fixed steps the frame time has built up. the last step is drawn one step behind, blended by how far the
+// frame got into the next one, so motion stays smooth at any frame rate while physics runs at fixed_dt
+int world_advance(VerletWorld* world, float frame_dt, int substeps)
+{
+	int steps = 0;
+
+	world->accumulator += frame_dt;
+
+	while((world->accumulator >= world->fixed_dt) && (steps < world->max_frame_steps))
+	{
+		snapshot_step_start(world);
+		world_step(world, world->fixed_dt, substeps);
+		world->accumulator -= world->fixed_dt;
+		steps++;
+	}
+
+	// a frame too long to catch up on is dropped rather than carried, or every following frame would run max steps
+	if(world->accumulator >= world->fixed_dt)
+		world->accumulator = fmodf(world->accumulator, world->fixed_dt);
+
+	world->alpha = world->accumulator / world->fixed_dt;
+	world_interpolate(world);
+
+	return steps;
+}
+
+void world_set_input(VerletWorld* world, VerletInput input)
+{
+	world->input = input;
+}
+
+CircleHandle world_pick(VerletWorld* world, Vector2 point)
+{
+	int picked = -1;
+
+	Circles* circles = &world->circles;
+
+	for(int i = 0; i < circles->size; i++)
+		if((circles->status[i] == FREE) && (Vector2Distance(point, (Vector2){ circles->x[i], circles->y[i] }) <= circles->radius[i]))
+			picked = i;
+
+	return circle_handle(circles, picked);
+}
+
+typedef struct
+{
+	Circles* circles;
+	Vector2 center;
+	float radius;
+	int* victims;
+	int count;
+	size_t capacity;
+} Eraser;
+
+static void mark_victim(void* context, int i)
+{
+	Eraser* eraser = context;
+	Circles* circles = eraser->circles;
+
+	if(!circles_overlap(eraser->center, eraser->radius, (Vector2){ circles->x[i], circles->y[i] }, circles->radius[i]))
+		return;
+
+	if(eraser->count == eraser->capacity)
+	{
+		eraser->capacity *= 2;
+		eraser->victims = realloc(eraser->victims, sizeof(int) * eraser->capacity);
+	}
+
+	eraser->victims[eraser->count++] = i;
+}
+
+int world_erase(VerletWorld* world, Vector2 center, float radius)
+{
+	Circles* circles = &world->circles;
+	Eraser eraser = { circles, center, radius, malloc(sizeof(int) * 16), 0, 16 };
+	int binned = query_bins(world, Vector2SubtractValue(center, radius), Vector2AddValue(center, radius), mark_victim, &eraser);
+
+	// circles added since the last build are not binned yet
+	for(int i = binned; i < circles->size; i++)
+		mark_victim(&eraser, i);
+
+	delete_verlet_circles(circles, eraser.victims, eraser.count);
+	free(eraser.victims);
+
+	// circles resting on the erased ones start to fall, and wake_unsupported brings the rest of the pile above after them.
+	// this runs once per erase, not per substep
+	if(world->sleeping && (eraser.count > 0))
+		for(int i = 0; i < circles->size; i++)
+			if((circles->status[i] == SLEEPING) && circles_overlap(center, (radius + (4 * circles->radius[i])), (Vector2){ circles->x[i], circles->y[i] }, circles->radius[i]))
+				wake_circle(circles, i);
+
+	return eraser.count;
+}
+
+void reset_world_stats(VerletWorld* world)
+{
+	for(int p = 0; p < PHASE_COUNT; p++)
+		atomic_init(&world->stats.phase_ns[p], 0);
+
+	for(int p = 0; p < PHASE_COUNT; p++)
+		for(int k = 0; k < COUNTER_COUNT; k++)
+			atomic_init(&world->stats.counters[p][k], 0);
+
+	atomic_init(&world->stats.counted, 0);
+	world->stats.step_ns = 0;
+	world->stats.circle_substeps = 0;
+	world->stats.steps = 0;
+}
+
+const char* step_phase_name(StepPhase phase)
+{
+	static const char* names[PHASE_COUNT] = { "setup", "integrate", "broadphase", "collide", "links" };
+
+	return ((phase >= 0) && (phase < PHASE_COUNT)) ? names[phase] : "unknown";
+}
+
+void dealloc_world(VerletWorld* world)
+{
+	free(world->step_start_x);
+	free(world->step_start_y);
+	free(world->draw_x);
+	free(world->draw_y);
+
+	dealloc_circles(&world->circles);
+	dealloc_chain(&world->chain);
+
+	if(world->pool != NULL)
+		dealloc_thread_pool(world->pool);
+
+	dealloc_task_graph(&world->step_graph);
+
+	if(world->grid != NULL)
+	{
+		dealloc_grid(world->grid);
+		free(world->grid);
+	}
+
+	if(world->hash != NULL)
+	{
+		dealloc_spatial_hash(world->hash);
+		free(world->hash);
+	}
+
+	if(world->neighbors != NULL)
+	{
+		dealloc_neighbor_list(world->neighbors);
+		free(world->neighbors);
+	}
+}